@@ -3,7 +3,12 @@
 // with the script engine before this can be used.
 // Before accessing the data in the array, InitArray() should be called with the script engine, the
 // AngelScript declaration for the array (ie "array<int>"), and optionally, the starting size of the array.
-// When the C++ programmer has finished with the array, he/she should call Release().
+// For the basic types the declaration can be left out (ie InitArray(engine)) and the array type is
+// looked up once per engine and cached.
+// The reference to the script array is released when the CScriptArraySTL object is destroyed, or
+// earlier by calling Release(). Either must happen before the script engine is released.
+// Copies of a CScriptArraySTL share the same script array and moves transfer it without touching
+// the reference count.
 // This class was written by Dominque Douglas
 // squaredprogramming@gmail.com
 // Copyright (c) 2014, Dominque A Douglas
@@ -24,16 +29,596 @@
 // POSSIBILITY OF SUCH DAMAGE.
 #pragma once
 
+#include <assert.h>
+#include <stddef.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <iterator>
 #include <memory>
 #include <stdexcept>
+#include <functional>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
 
-#include "..\scriptarray\scriptarray.h"
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+#include <string_view>
+#define SCRIPTARRAYSTL_HAS_STRING_VIEW
+#endif
+
+#include "../scriptarray/scriptarray.h"
 
 #define ASSERT_IF_UNITIALIZED
 
+// sort() and stable_sort() split arrays with at least this many elements across threads
+#ifndef SCRIPTARRAYSTL_PARALLEL_SORT_THRESHOLD
+#define SCRIPTARRAYSTL_PARALLEL_SORT_THRESHOLD 100000
+#endif
+
+// Define SCRIPTARRAYSTL_INSTRUMENT to count element accesses, reallocations and growth.
+// See ScriptArraySTLStats.h. When it isn't defined these compile to nothing.
+#ifdef SCRIPTARRAYSTL_INSTRUMENT
+#include "ScriptArraySTLStats.h"
+#define SCRIPTARRAYSTL_COUNT_ACCESS()  count_access()
+#define SCRIPTARRAYSTL_COUNT_COPY(n)   count_copy(n)
+#define SCRIPTARRAYSTL_TRACK_CHANGES() change_tracker tracker(*this)
+#else
+#define SCRIPTARRAYSTL_COUNT_ACCESS()
+#define SCRIPTARRAYSTL_COUNT_COPY(n)
+#define SCRIPTARRAYSTL_TRACK_CHANGES()
+#endif
+
+// Describes whether the script array stores elements of type T as a contiguous run of T.
+// CScriptArray keeps primitives and handles directly inside its buffer, so for those types
+// the buffer returned by GetBuffer() can be used as a plain C array. Every other object type
+// (including POD value types) is stored as a pointer to a separately allocated object and
+// has to be reached through At(), so those use the index based iterator.
+// Specialize this to false for a type to force the index based iterator.
+template <class T>
+struct CScriptArraySTL_is_contiguous
+{
+	static const bool value = std::is_arithmetic<T>::value || std::is_enum<T>::value || std::is_pointer<T>::value;
+};
+
+// Maps a C++ element type to the AngelScript declaration of that type. This is what lets
+// InitArray(engine) find the script array type without the caller passing a declaration.
+// Application registered types can be added by specializing this, for example
+//     template <> struct CScriptArraySTL_type<Vec3> { static const char *decl() { return "vec3"; } };
+template <class T>
+struct CScriptArraySTL_type;
+
+template <> struct CScriptArraySTL_type<bool>               { static const char *decl() { return "bool"; } };
+template <> struct CScriptArraySTL_type<signed char>        { static const char *decl() { return "int8"; } };
+template <> struct CScriptArraySTL_type<short>              { static const char *decl() { return "int16"; } };
+template <> struct CScriptArraySTL_type<int>                { static const char *decl() { return "int"; } };
+template <> struct CScriptArraySTL_type<long long>          { static const char *decl() { return "int64"; } };
+template <> struct CScriptArraySTL_type<unsigned char>      { static const char *decl() { return "uint8"; } };
+template <> struct CScriptArraySTL_type<unsigned short>     { static const char *decl() { return "uint16"; } };
+template <> struct CScriptArraySTL_type<unsigned int>       { static const char *decl() { return "uint"; } };
+template <> struct CScriptArraySTL_type<unsigned long long> { static const char *decl() { return "uint64"; } };
+template <> struct CScriptArraySTL_type<float>              { static const char *decl() { return "float"; } };
+template <> struct CScriptArraySTL_type<double>             { static const char *decl() { return "double"; } };
+template <> struct CScriptArraySTL_type<std::string>        { static const char *decl() { return "string"; } };
+
+// char, long and unsigned long are distinct types from the ones above, so they are mapped to the
+// script type with the same size and signedness (long is 64 bits on LP64 systems, 32 on Windows)
+template <> struct CScriptArraySTL_type<char>          { static const char *decl() { return std::is_signed<char>::value ? "int8" : "uint8"; } };
+template <> struct CScriptArraySTL_type<long>          { static const char *decl() { return sizeof(long) == 8 ? "int64" : "int"; } };
+template <> struct CScriptArraySTL_type<unsigned long> { static const char *decl() { return sizeof(unsigned long) == 8 ? "uint64" : "uint"; } };
+
+// handles are declared as the type they point to followed by @
+template <class T>
+struct CScriptArraySTL_type<T *>
+{
+	static std::string decl() { return std::string(CScriptArraySTL_type<T>::decl()) + "@"; }
+};
+
+// engine user data slot used for the cache of array types
+#ifndef SCRIPTARRAYSTL_TYPE_CACHE
+#define SCRIPTARRAYSTL_TYPE_CACHE 0x53544C00
+#endif
+
+// Per-engine cache of the script array types used by CScriptArraySTL. Each C++ element type is
+// given a slot the first time it is used, so after the first InitArray(engine) for a type the
+// lookup is an index into a vector with no string parsing. The cache is stored as user data on
+// the engine and is deleted when the engine is released.
+class CScriptArraySTLTypeCache
+{
+public:
+	// returns the array<T> object type for the engine or NULL if it couldn't be resolved.
+	// error is set to -1 if the type doesn't exist or -2 if the size of T doesn't match
+	// the size of the script element type.
+	template <class T>
+	static asIObjectType *GetArrayType(asIScriptEngine *engine, int *error = NULL)
+	{
+		static const size_t slot = NextSlot();
+
+		// fast path, the type has already been resolved for this engine
+		asAcquireSharedLock();
+		CScriptArraySTLTypeCache *cache = (CScriptArraySTLTypeCache *)engine->GetUserData(SCRIPTARRAYSTL_TYPE_CACHE);
+		asIObjectType *t = (cache && slot < cache->m_types.size()) ? cache->m_types[slot] : NULL;
+		asReleaseSharedLock();
+		if(t != NULL) return t;
+
+		// first use of the type with this engine, look it up by its declaration
+		std::string declaration = std::string("array<") + CScriptArraySTL_type<T>::decl() + ">";
+		t = engine->GetObjectTypeById(engine->GetTypeIdByDecl(declaration.c_str()));
+		if(t == NULL)
+		{
+			if(error) *error = -1; // the type doesn't exist
+			return NULL;
+		}
+		if(!ElementSizeMatches(engine, t, sizeof(T)))
+		{
+			assert(false && "The size of the C++ type doesn't match the script element type.");
+			if(error) *error = -2;
+			return NULL;
+		}
+
+		asAcquireExclusiveLock();
+		cache = (CScriptArraySTLTypeCache *)engine->GetUserData(SCRIPTARRAYSTL_TYPE_CACHE);
+		if(cache == NULL)
+		{
+			cache = new CScriptArraySTLTypeCache();
+			engine->SetUserData(cache, SCRIPTARRAYSTL_TYPE_CACHE);
+			engine->SetEngineUserDataCleanupCallback(CleanupEngine, SCRIPTARRAYSTL_TYPE_CACHE);
+		}
+		if(slot >= cache->m_types.size()) cache->m_types.resize(slot + 1, NULL);
+		if(cache->m_types[slot] == NULL)
+		{
+			// the cache holds a reference until the engine is destroyed
+			t->AddRef();
+			cache->m_types[slot] = t;
+		}
+		t = cache->m_types[slot];
+		asReleaseExclusiveLock();
+
+		return t;
+	}
+
+private:
+	std::vector<asIObjectType *> m_types;
+
+	static size_t NextSlot()
+	{
+		static std::atomic<size_t> next(0);
+		return next++;
+	}
+
+	// checks that a T can be laid over the memory of a script element
+	static bool ElementSizeMatches(asIScriptEngine *engine, asIObjectType *t, size_t size)
+	{
+		int sub_type_id = t->GetSubTypeId();
+		if(sub_type_id & asTYPEID_OBJHANDLE)
+		{
+			return size == sizeof(void *);
+		}
+		if(sub_type_id & asTYPEID_MASK_OBJECT)
+		{
+			// reference types don't always report a size
+			asUINT type_size = t->GetSubType()->GetSize();
+			return (type_size == 0) || (type_size == size);
+		}
+		return (size_t)engine->GetSizeOfPrimitiveType(sub_type_id) == size;
+	}
+
+	static void CleanupEngine(asIScriptEngine *engine)
+	{
+		CScriptArraySTLTypeCache *cache = (CScriptArraySTLTypeCache *)engine->GetUserData(SCRIPTARRAYSTL_TYPE_CACHE);
+		if(cache == NULL) return;
+
+		for(size_t i = 0; i < cache->m_types.size(); ++i)
+		{
+			if(cache->m_types[i] != NULL) cache->m_types[i]->Release();
+		}
+		delete cache;
+	}
+};
+
+// CScriptArray keeps its buffer protected. This names the member through a derived class so
+// the capacity can be read and buffers exchanged on any CScriptArray. It is never constructed.
+struct CScriptArraySTL_buffer_access : public CScriptArray
+{
+	static SArrayBuffer *&Buffer(CScriptArray *a)
+	{
+		return a->*(&CScriptArraySTL_buffer_access::buffer);
+	}
+
+	static asUINT Capacity(const CScriptArray *a)
+	{
+		return (a->*(&CScriptArraySTL_buffer_access::buffer))->maxElements;
+	}
+};
+
+// A range of element indices, first up to but not including last
+struct SScriptArraySTLRange
+{
+	size_t first;
+	size_t last;
+};
+
+// Creates the script arrays for InitArray() and releases the references that CScriptArraySTL
+// holds. Array classes that are recycled instead of deleted, like CScriptArrayPooled, specialize
+// this. CScriptArray::Release() frees the object with the array add-on's memory functions, so
+// array classes derived from CScriptArray allocate themselves with them in their operator new.
+template <class TArrayClass>
+struct CScriptArraySTL_factory
+{
+	static TArrayClass *Create(asIObjectType *t, asUINT length)
+	{
+		return new TArrayClass(length, t);
+	}
+
+	static void Release(TArrayClass *as_array)
+	{
+		as_array->Release();
+	}
+};
+
+// plain arrays are made with CScriptArray::Create(), which allocates them with those functions
+template <>
+struct CScriptArraySTL_factory<CScriptArray>
+{
+	static CScriptArray *Create(asIObjectType *t, asUINT length)
+	{
+		return CScriptArray::Create(t, length);
+	}
+
+	static void Release(CScriptArray *as_array)
+	{
+		as_array->Release();
+	}
+};
+
+// True for array classes whose buffers are plain heap buffers that any of these array classes can
+// own and free, which is what swap_contents() needs. Array classes that keep their buffer
+// somewhere else (borrowed C++ memory, arenas, ...) leave this false.
+template <class TArrayClass>
+struct CScriptArraySTL_heap_buffer
+{
+	static const bool value = false;
+};
+
+template <>
+struct CScriptArraySTL_heap_buffer<CScriptArray>
+{
+	static const bool value = true;
+};
+
+// Records which elements CScriptArraySTL changes. Array classes that keep track of their changed
+// elements, like CScriptArrayTracked, specialize this. For other array classes nothing is recorded
+// and every element is reported as changed.
+template <class TArrayClass>
+struct CScriptArraySTL_tracker
+{
+	static void MarkDirty(TArrayClass *, size_t, size_t)
+	{
+	}
+
+	static std::vector<SScriptArraySTLRange> ConsumeDirtyRanges(TArrayClass *as_array)
+	{
+		std::vector<SScriptArraySTLRange> ranges;
+		if(as_array->GetSize() > 0)
+		{
+			SScriptArraySTLRange all = { 0, as_array->GetSize() };
+			ranges.push_back(all);
+		}
+		return ranges;
+	}
+};
+
+// Extra members and ownership hooks for particular element types. CScriptArraySTL derives from
+// this and calls the hooks around its bulk operations. The generic version adds nothing.
+template <class T, class TArraySTL>
+class CScriptArraySTL_extension
+{
+protected:
+	// called before the elements in [first, last) are destroyed or overwritten
+	void release_range(size_t, size_t) {}
+
+	// called before the values in [first, last) are copied into the buffer
+	template <class ForwardIterator>
+	void addref_values(ForwardIterator, ForwardIterator) {}
+
+	// called after the elements in [first, last) have been copied into the buffer
+	void addref_range(size_t, size_t) {}
+};
+
+// true if T has AddRef() and Release() methods that can be called directly
+template <class T>
+struct CScriptArraySTL_has_refcount
+{
+	template <class U> static char test(decltype(std::declval<U &>().AddRef()) *, decltype(std::declval<U &>().Release()) *);
+	template <class U> static long test(...);
+	static const bool value = sizeof(test<T>(0, 0)) == 1;
+};
+
+// How handles in an array of T* are referenced. Types with AddRef() and Release() methods (which
+// includes asIScriptObject) are called directly, everything else goes through the engine.
+// Specialize this for types whose reference counting works differently.
+template <class T, bool native = CScriptArraySTL_has_refcount<T>::value>
+struct CScriptArraySTL_handle_traits
+{
+	static void AddRef(T *handle, asIObjectType *)  { handle->AddRef(); }
+	static void Release(T *handle, asIObjectType *) { handle->Release(); }
+};
+
+template <class T>
+struct CScriptArraySTL_handle_traits<T, false>
+{
+	static void AddRef(T *handle, asIObjectType *t)  { t->GetEngine()->AddRefScriptObject(handle, t); }
+	static void Release(T *handle, asIObjectType *t) { t->GetEngine()->ReleaseScriptObject(handle, t); }
+};
+
+// Arrays of handles (array<Obj@>). CScriptArray adds and releases a reference through the engine
+// for every element it copies in or destroys. For handle arrays, assign, append, insert, resize,
+// pop_back and clear instead release the old handles and add references to the new ones in one
+// pass that calls AddRef/Release directly, and then let the array see only null handles.
+// Storing a handle through operator[], an iterator or data() writes the pointer without adding
+// or releasing a reference. Use adopt_back()/adopt() to hand over references that are already
+// held and take_back()/take_all() to take them out again without touching the counts.
+template <class T, class TArraySTL>
+class CScriptArraySTL_extension<T *, TArraySTL>
+{
+public:
+	// adds a handle to the end of the array. The array takes over a reference the caller holds.
+	void adopt_back(T *handle)
+	{
+		adopt(&handle, &handle + 1);
+	}
+
+	// adds handles to the end of the array. The array takes over references the caller holds.
+	template <class ForwardIterator>
+	void adopt(ForwardIterator first, ForwardIterator last)
+	{
+		TArraySTL &self = array();
+		size_t index = self.size();
+		self.resize(index + (size_t)std::distance(first, last));
+		std::copy(first, last, self.data() + index);
+	}
+
+	// removes the last handle and returns it. The caller takes over the array's reference.
+	// undefined if empty
+	T *take_back()
+	{
+		TArraySTL &self = array();
+		T *handle = self.back();
+		self.back() = NULL;
+		self.resize(self.size() - 1);
+		return handle;
+	}
+
+	// moves every handle to out and empties the array. The caller takes over the references.
+	template <class OutputIterator>
+	OutputIterator take_all(OutputIterator out)
+	{
+		TArraySTL &self = array();
+		out = std::copy(self.data(), self.data() + self.size(), out);
+		std::fill(self.data(), self.data() + self.size(), (T *)NULL);
+		self.resize(0);
+		return out;
+	}
+
+protected:
+	void release_range(size_t first, size_t last)
+	{
+		TArraySTL &self = array();
+		if(first >= last) return;
+
+		asIObjectType *t = self.GetRef()->GetArrayObjectType()->GetSubType();
+		T **handles = self.data();
+		for(size_t i = first; i < last; ++i)
+		{
+			if(handles[i] != NULL)
+			{
+				CScriptArraySTL_handle_traits<T>::Release(handles[i], t);
+				handles[i] = NULL;
+			}
+		}
+	}
+
+	template <class ForwardIterator>
+	void addref_values(ForwardIterator first, ForwardIterator last)
+	{
+		asIObjectType *t = array().GetRef()->GetArrayObjectType()->GetSubType();
+		for(; first != last; ++first)
+		{
+			if(*first != NULL) CScriptArraySTL_handle_traits<T>::AddRef(*first, t);
+		}
+	}
+
+	void addref_range(size_t first, size_t last)
+	{
+		T **handles = array().data();
+		addref_values(handles + first, handles + last);
+	}
+
+private:
+	TArraySTL &array()
+	{
+		return static_cast<TArraySTL &>(*this);
+	}
+};
+
+// Arrays of strings (array<string>). The script array stores each string as a separately
+// allocated object, so besides the copying members these move strings in and out and fill the
+// array straight from a character buffer. Strings moved out leave an empty string behind.
+template <class TArraySTL>
+class CScriptArraySTL_extension<std::string, TArraySTL>
+{
+public:
+	// adds a string to the end of the array without copying its characters
+	void move_back(std::string &&str)
+	{
+		TArraySTL &self = array();
+		self.resize(self.size() + 1);
+		*strings()[self.size() - 1] = std::move(str);
+	}
+
+	// replaces the contents of the array by moving the strings in [first, last)
+	template <class ForwardIterator>
+	void move_assign(ForwardIterator first, ForwardIterator last)
+	{
+		array().resize((size_t)std::distance(first, last));
+		move_into(0, first, last);
+	}
+
+	// moves the strings in [first, last) to the end of the array
+	template <class ForwardIterator>
+	void move_append(ForwardIterator first, ForwardIterator last)
+	{
+		TArraySTL &self = array();
+		size_t index = self.size();
+		self.resize(index + (size_t)std::distance(first, last));
+		move_into(index, first, last);
+	}
+
+	// moves a string out of the array. The element is left empty
+	std::string take(size_t index)
+	{
+		std::string &element = array()[index];
+		std::string str(std::move(element));
+		element.clear();
+		return str;
+	}
+
+	// moves every string to out and empties the array
+	template <class OutputIterator>
+	OutputIterator take_all(OutputIterator out)
+	{
+		TArraySTL &self = array();
+		std::string **p = strings();
+		for(size_t i = 0; i < self.size(); ++i)
+		{
+			*out = std::move(*p[i]);
+			++out;
+		}
+		self.resize(0);
+		return out;
+	}
+
+	// Replaces the contents of the array with count strings cut out of chars. String i is
+	// chars[offsets[i]] up to chars[offsets[i + 1]], so offsets holds count + 1 entries. Strings
+	// that are already in the array keep their storage, so reloading an array of the same size
+	// doesn't allocate unless a string grows.
+	template <class Offset>
+	void load(const char *chars, const Offset *offsets, size_t count)
+	{
+		array().resize(count);
+		std::string **p = strings();
+		for(size_t i = 0; i < count; ++i)
+		{
+			p[i]->assign(chars + offsets[i], (size_t)(offsets[i + 1] - offsets[i]));
+		}
+		array().mark_dirty(0, count);
+	}
+
+#ifdef SCRIPTARRAYSTL_HAS_STRING_VIEW
+	// read only iterator that gives std::string_views of the strings in the array. Like the
+	// array's iterators it is invalidated by anything that resizes the array.
+	class view_iterator
+	{
+		private:
+			const std::string *const *_p;
+
+		public:
+			typedef std::random_access_iterator_tag	iterator_category;
+			typedef std::string_view				value_type;
+			typedef ptrdiff_t						difference_type;
+			typedef const std::string_view			*pointer;
+			typedef std::string_view				reference;
+
+			explicit view_iterator(const std::string *const *p = NULL) :_p(p) {}
+
+			std::string_view operator*() const						{ return **_p; }
+			std::string_view operator[](difference_type n) const	{ return *_p[n]; }
+
+			view_iterator &operator++()								{ ++_p; return *this; }
+			view_iterator operator++(int)							{ view_iterator copy(*this); ++_p; return copy; }
+			view_iterator &operator--()								{ --_p; return *this; }
+			view_iterator operator--(int)							{ view_iterator copy(*this); --_p; return copy; }
+			view_iterator &operator+=(difference_type n)			{ _p += n; return *this; }
+			view_iterator &operator-=(difference_type n)			{ _p -= n; return *this; }
+			view_iterator operator+(difference_type n) const		{ return view_iterator(_p + n); }
+			view_iterator operator-(difference_type n) const		{ return view_iterator(_p - n); }
+			difference_type operator-(const view_iterator &other) const { return _p - other._p; }
+			friend view_iterator operator+(difference_type n, const view_iterator &it) { return view_iterator(it._p + n); }
+
+			bool operator==(const view_iterator &other) const		{ return _p == other._p; }
+			bool operator!=(const view_iterator &other) const		{ return _p != other._p; }
+			bool operator<(const view_iterator &other) const		{ return _p < other._p; }
+			bool operator>(const view_iterator &other) const		{ return _p > other._p; }
+			bool operator<=(const view_iterator &other) const		{ return _p <= other._p; }
+			bool operator>=(const view_iterator &other) const		{ return _p >= other._p; }
+	};
+
+	// a begin/end pair so the views can be used in a range based for loop
+	struct view_range
+	{
+		view_iterator first, last;
+
+		view_iterator begin() const { return first; }
+		view_iterator end() const { return last; }
+		size_t size() const { return (size_t)(last - first); }
+	};
+
+	std::string_view view(size_t index) const
+	{
+		return *const_cast<CScriptArraySTL_extension *>(this)->strings()[index];
+	}
+
+	view_iterator view_begin() const
+	{
+		return view_iterator(const_cast<CScriptArraySTL_extension *>(this)->strings());
+	}
+
+	view_iterator view_end() const
+	{
+		return view_begin() + (ptrdiff_t)static_cast<const TArraySTL &>(*this).size();
+	}
+
+	view_range views() const
+	{
+		view_range range = { view_begin(), view_end() };
+		return range;
+	}
+#endif
+
+protected:
+	void release_range(size_t, size_t) {}
+	template <class ForwardIterator>
+	void addref_values(ForwardIterator, ForwardIterator) {}
+	void addref_range(size_t, size_t) {}
+
+private:
+	TArraySTL &array()
+	{
+		return static_cast<TArraySTL &>(*this);
+	}
+
+	// the script array stores a pointer to each string
+	std::string **strings()
+	{
+		return (std::string **)array().GetRef()->GetBuffer();
+	}
+
+	template <class ForwardIterator>
+	void move_into(size_t index, ForwardIterator first, ForwardIterator last)
+	{
+		std::string **p = strings() + index;
+		for(; first != last; ++first, ++p)
+		{
+			**p = std::move(*first);
+		}
+		array().mark_dirty(index, (size_t)(p - strings()));
+	}
+};
 
 template <class T, class TArrayClass = CScriptArray>
-class CScriptArraySTL
+class CScriptArraySTL : public CScriptArraySTL_extension<T, CScriptArraySTL<T, TArrayClass> >
 {
 public:
 	typedef T          value_type;
@@ -44,18 +629,31 @@ public:
 	typedef size_t     size_type;
 	typedef ptrdiff_t  difference_type;
 
+	// true if the elements are stored as a contiguous run of T inside the script array's buffer
+	static const bool is_contiguous = CScriptArraySTL_is_contiguous<T>::value;
+
 	// iterator -------------------------------------------------------------------------------
+	// index based iterator. This is used for element types that CScriptArray doesn't store
+	// contiguously. Each dereference goes through CScriptArraySTL::operator[]
 	template <class Ty, class TScriptArrayClass>
-	class CScriptArraySTL_iterator : public std::iterator<std::random_access_iterator_tag, Ty>
+	class CScriptArraySTL_iterator
 	{
 		private:
 			TScriptArrayClass	*_buf;
 			size_type			 _pos;
 
+			template <class, class> friend class CScriptArraySTL_iterator;
+
 		public:
-			// b should be a null terminated string in UTF-8
-			// if this is the end start_pos should be the index of the null terminator
-			// start_pos should be the valid start of a character
+			typedef std::random_access_iterator_tag	iterator_category;
+			typedef Ty								value_type;
+			typedef ptrdiff_t						difference_type;
+			typedef Ty								*pointer;
+			typedef Ty								&reference;
+
+			// b is the array that is being iterated over
+			// p is the index of the element that the iterator points to
+			// if this is the end p should be the size of the array
 			CScriptArraySTL_iterator(TScriptArrayClass	*b, size_type p)
 				:_buf(b), _pos(p)
 			{
@@ -67,12 +665,30 @@ public:
 			{
 			}
 
+			// lets an iterator be used where a const_iterator is expected
+			template <class OtherTy, class OtherArrayClass>
+			CScriptArraySTL_iterator(const CScriptArraySTL_iterator<OtherTy, OtherArrayClass> &other,
+				typename std::enable_if<std::is_convertible<OtherArrayClass *, TScriptArrayClass *>::value>::type * = 0)
+				:_buf(other._buf), _pos(other._pos)
+			{
+			}
+
 			reference operator*() const
 			{
-				// returns the character currently being pointed to
+				// returns the element currently being pointed to
 				return (*_buf)[_pos];
 			}
 
+			pointer operator->() const
+			{
+				return &(*_buf)[_pos];
+			}
+
+			reference operator[](difference_type n) const
+			{
+				return (*_buf)[_pos + n];
+			}
+
 			// does not check to see if it goes past the end
 			// iterating past the end is undefined
 			CScriptArraySTL_iterator &operator++()
@@ -143,43 +759,54 @@ public:
 				return _pos >= other._pos;
 			}
 
-			CScriptArraySTL_iterator &operator += (size_type n)
+			CScriptArraySTL_iterator &operator += (difference_type n)
 			{
 				_pos += n;
 				return *this;
 			}
 
-			CScriptArraySTL_iterator &operator -= (size_type n)
+			CScriptArraySTL_iterator &operator -= (difference_type n)
 			{
 				_pos -= n;
 				return *this;
 			}
 
-			CScriptArraySTL_iterator operator + ( size_type n ) const
+			CScriptArraySTL_iterator operator + ( difference_type n ) const
 			{
 				return CScriptArraySTL_iterator(_buf, _pos + n);
 			}
 
-			CScriptArraySTL_iterator operator - ( size_type n ) const
+			CScriptArraySTL_iterator operator - ( difference_type n ) const
 			{
 				return CScriptArraySTL_iterator(_buf, _pos - n);
 			}
 
-			size_type operator - ( const CScriptArraySTL_iterator &other ) const
+			difference_type operator - ( const CScriptArraySTL_iterator &other ) const
 			{
-				return _pos - other._pos;
+				return (difference_type)_pos - (difference_type)other._pos;
 			}
 
-			template <class T, class TArrayClass>
-			friend CScriptArraySTL_iterator operator + ( size_type n, const CScriptArraySTL_iterator &it )
+			friend CScriptArraySTL_iterator operator + ( difference_type n, const CScriptArraySTL_iterator &it )
 			{
-				return CScriptArraySTL<T, TArrayClass>::CScriptArraySTL_iterator(it._buf, it._pos + n);
+				return CScriptArraySTL_iterator(it._buf, it._pos + n);
+			}
+
+			// returns the array that is being iterated over
+			TScriptArrayClass *container() const
+			{
+				return _buf;
 			}
 	};
 
 	// make our iterator types here
-	typedef CScriptArraySTL_iterator<value_type, CScriptArraySTL>				iterator;
-	typedef CScriptArraySTL_iterator<const value_type, const CScriptArraySTL>	const_iterator;
+	// contiguous element types iterate with raw pointers into the script array's buffer so
+	// algorithms like std::copy and std::sort work on plain pointer arithmetic
+	typedef typename std::conditional<is_contiguous,
+		pointer,
+		CScriptArraySTL_iterator<value_type, CScriptArraySTL> >::type				iterator;
+	typedef typename std::conditional<is_contiguous,
+		const_pointer,
+		CScriptArraySTL_iterator<const value_type, const CScriptArraySTL> >::type	const_iterator;
 	typedef std::reverse_iterator<iterator>										reverse_iterator;
 	typedef std::reverse_iterator<const_iterator>								const_reverse_iterator;
 
@@ -189,24 +816,134 @@ public:
 	{
 	}
 
+	// Attaches to an array that was created somewhere else, for example an array returned from
+	// a script function or passed to a registered function. If add_ref is true a new reference
+	// is taken. If add_ref is false the reference the caller already holds is adopted, which is
+	// what is wanted for handles (array<T>@) passed to registered functions.
+	explicit CScriptArraySTL(TArrayClass *as_array, bool add_ref = true)
+		:m_as_array_ptr(NULL)
+	{
+		Attach(as_array, add_ref);
+	}
+
+	// copies share the same script array. The reference count is incremented.
+	CScriptArraySTL(const CScriptArraySTL &other)
+		:m_as_array_ptr(other.m_as_array_ptr)
+	{
+		if(m_as_array_ptr != NULL) m_as_array_ptr->AddRef();
+	}
+
+	// moves the reference to the script array without touching the reference count
+	CScriptArraySTL(CScriptArraySTL &&other)
+		:m_as_array_ptr(other.m_as_array_ptr)
+	{
+		other.m_as_array_ptr = NULL;
+	}
+
+	// releases the reference to the script array if one is still held. As with Release(), this
+	// must happen before the script engine is released.
 	~CScriptArraySTL(void)
 	{
-#if DEBUG || _DEBUG
-		assert((m_as_array_ptr == NULL) && "Should be destoyed by calling Release() before the script engine has been released.");
-#endif
+		if(m_as_array_ptr != NULL) CScriptArraySTL_factory<TArrayClass>::Release(m_as_array_ptr);
+	}
+
+	CScriptArraySTL &operator = (const CScriptArraySTL &other)
+	{
+		CScriptArraySTL copy(other);
+		swap(copy);
+		return *this;
+	}
+
+	CScriptArraySTL &operator = (CScriptArraySTL &&other)
+	{
+		if(this != &other)
+		{
+			if(m_as_array_ptr != NULL) CScriptArraySTL_factory<TArrayClass>::Release(m_as_array_ptr);
+			m_as_array_ptr = other.m_as_array_ptr;
+			other.m_as_array_ptr = NULL;
+		}
+		return *this;
+	}
+
+	// exchanges the script arrays held by two objects
+	void swap(CScriptArraySTL &other)
+	{
+		std::swap(m_as_array_ptr, other.m_as_array_ptr);
+	}
+
+	// Exchanges the elements of two script arrays without copying them or touching reference
+	// counts. Unlike swap() each script array keeps its identity, so scripts holding either one
+	// see the other's elements. Both must be the same array type, and both array classes must use
+	// plain heap buffers (see CScriptArraySTL_heap_buffer).
+	template <class TOtherArrayClass>
+	void swap_contents(CScriptArraySTL<T, TOtherArrayClass> &other)
+	{
+		static_assert(CScriptArraySTL_heap_buffer<TArrayClass>::value && CScriptArraySTL_heap_buffer<TOtherArrayClass>::value,
+			"swap_contents() can only exchange plain heap buffers, which other arrays can own and free");
+
+		CScriptArray *mine = GetRef();
+		CScriptArray *theirs = other.GetRef();
+		assert((mine->GetArrayObjectType() == theirs->GetArrayObjectType()) && "swap_contents() requires arrays of the same type.");
+		std::swap(CScriptArraySTL_buffer_access::Buffer(mine), CScriptArraySTL_buffer_access::Buffer(theirs));
+		mark_dirty(0, size());
+		other.mark_dirty(0, other.size());
+	}
+
+	// Attaches to an existing array. Any array that was held before is released.
+	// See the attaching constructor for the meaning of add_ref.
+	void Attach(TArrayClass *as_array, bool add_ref = true)
+	{
+		if(as_array != NULL)
+		{
+			CheckElementType(as_array->GetArrayObjectType());
+			if(add_ref) as_array->AddRef();
+		}
+		if(m_as_array_ptr != NULL) CScriptArraySTL_factory<TArrayClass>::Release(m_as_array_ptr);
+		m_as_array_ptr = as_array;
+	}
+
+	// Disconnects the array from this object without releasing it and returns it. The caller
+	// becomes responsible for the reference this object held.
+	TArrayClass *Detach()
+	{
+		TArrayClass *rval = m_as_array_ptr;
+		m_as_array_ptr = NULL;
+		return rval;
 	}
 
 	// Initializes the array so it can be directly accessed using AngelScript
 	// This must be called before the array can be used
-	int InitArray(asIScriptEngine *engine, char *declaration, size_type init_length = 0)
+	// The array type is found from T using CScriptArraySTL_type and is cached per engine, so
+	// this is the fastest way to create arrays of the basic types.
+	int InitArray(asIScriptEngine *engine, size_type init_length = 0)
+	{
+		int error = 0;
+		asIObjectType* t = CScriptArraySTLTypeCache::GetArrayType<value_type>(engine, &error);
+		if(t == NULL) return error;
+
+		return InitArray(t, init_length);
+	}
+
+	// Initializes the array using the AngelScript declaration for the array (ie "array<int>")
+	// This parses the declaration on every call. Prefer InitArray(engine) for types that have
+	// a CScriptArraySTL_type specialization.
+	int InitArray(asIScriptEngine *engine, const char *declaration, size_type init_length = 0)
 	{
 		// The script array needs to know its type to properly handle the elements.
-		// Note that the object type should be cached to avoid performance issues
-		// if the function is called frequently.
 		asIObjectType* t = engine->GetObjectTypeById(engine->GetTypeIdByDecl(declaration));
 		if(t == NULL) return -1; // the type doesn't exist
 
-		m_as_array_ptr = new TArrayClass(init_length, t);
+		return InitArray(t, init_length);
+	}
+
+	// Initializes the array from an array object type that has already been looked up
+	int InitArray(asIObjectType *t, size_type init_length = 0)
+	{
+		CheckElementType(t);
+
+		// an array that was already held is released
+		if(m_as_array_ptr != NULL) CScriptArraySTL_factory<TArrayClass>::Release(m_as_array_ptr);
+		m_as_array_ptr = CScriptArraySTL_factory<TArrayClass>::Create(t, (asUINT)init_length);
 
 		return 0;
 	}
@@ -249,7 +986,7 @@ public:
 #ifdef ASSERT_IF_UNITIALIZED
 		assert((m_as_array_ptr != NULL) && "InitArray() must be called before use.");
 #endif
-		m_as_array_ptr->Release();
+		CScriptArraySTL_factory<TArrayClass>::Release(m_as_array_ptr);
 		m_as_array_ptr = NULL;
 	}
 
@@ -268,6 +1005,8 @@ public:
 #ifdef ASSERT_IF_UNITIALIZED
 		assert((m_as_array_ptr != NULL) && "InitArray() must be called before use.");
 #endif
+		if(n < size()) this->release_range(n, size());
+		SCRIPTARRAYSTL_TRACK_CHANGES();
 		m_as_array_ptr->Resize(n);
 	}
 
@@ -286,6 +1025,7 @@ public:
 #ifdef ASSERT_IF_UNITIALIZED
 		assert((m_as_array_ptr != NULL) && "InitArray() must be called before use.");
 #endif
+		SCRIPTARRAYSTL_TRACK_CHANGES();
 		m_as_array_ptr->Reserve(n);
 	}
 
@@ -293,30 +1033,30 @@ public:
 	// returns an iterator to the begining of the array
 	iterator begin()
 	{
-		return iterator(this, 0);
+		return make_iterator(0, contiguous_tag());
 	}
 	// returns an iterator to the end of the array
 	iterator end()
 	{
-		return iterator(this, size());
+		return make_iterator(size(), contiguous_tag());
 	}
 	// returns a constant iterator to the begining of the array
 	const_iterator cbegin() const
 	{
-		return const_iterator(this, 0);
+		return make_iterator(0, contiguous_tag());
 	}
 	// returns a constant iterator to the end of the array
 	const_iterator cend() const
 	{
-		return const_iterator(this, size());
+		return make_iterator(size(), contiguous_tag());
 	}
 	// returns a constant iterator to the begining of the array
-	iterator begin() const
+	const_iterator begin() const
 	{
 		return cbegin();
 	}
 	// returns a constant iterator to the end of the array
-	iterator end() const
+	const_iterator end() const
 	{
 		return cend();
 	}
@@ -353,6 +1093,29 @@ public:
 	}
 
 	// Element Access -----------------------------------------------------------------------
+	// returns a pointer to the first element in the script array's buffer. Only available for
+	// contiguous element types. The pointer is invalidated by anything that reallocates the
+	// buffer (resize, reserve, push_back or changes made in AngelScript).
+	pointer data()
+	{
+		static_assert(is_contiguous, "data() requires an element type that is stored contiguously");
+#ifdef ASSERT_IF_UNITIALIZED
+		assert((m_as_array_ptr != NULL) && "InitArray() must be called before use.");
+#endif
+		return (pointer)m_as_array_ptr->GetBuffer();
+	}
+
+	// returns a constant pointer to the first element in the script array's buffer
+	const_pointer data() const
+	{
+		static_assert(is_contiguous, "data() requires an element type that is stored contiguously");
+#ifdef ASSERT_IF_UNITIALIZED
+		assert((m_as_array_ptr != NULL) && "InitArray() must be called before use.");
+#endif
+		// GetBuffer() isn't const in CScriptArray
+		return (const_pointer)const_cast<TArrayClass *>(m_as_array_ptr)->GetBuffer();
+	}
+
 	// returns a reference to an element in the array. This will not throw an out-of-range exception.
 	// undefined behavior if out of range.
 	reference operator[](size_type index)
@@ -363,9 +1126,9 @@ public:
 #ifdef ASSERT_IF_UNITIALIZED
 		assert((m_as_array_ptr != NULL) && "InitArray() must be called before use.");
 #endif
-		pointer element = (pointer)m_as_array_ptr->At(index);
-
-		return (*element);
+		SCRIPTARRAYSTL_COUNT_ACCESS();
+		mark_dirty(index, index + 1);
+		return element(index, contiguous_tag());
 	}
 
 	// returns a const reference to an element in the array. This will not throw an out-of-range exception.
@@ -379,9 +1142,8 @@ public:
 #ifdef ASSERT_IF_UNITIALIZED
 		assert((m_as_array_ptr != NULL) && "InitArray() must be called before use.");
 #endif
-		const_pointer element = (const_pointer)m_as_array_ptr->At(index);
-
-		return (*element);
+		SCRIPTARRAYSTL_COUNT_ACCESS();
+		return element(index, contiguous_tag());
 	}
 
 	// returns a reference to an element in the array. This will throw an out-of-range exception.
@@ -392,22 +1154,25 @@ public:
 #ifdef ASSERT_IF_UNITIALIZED
 		assert((m_as_array_ptr != NULL) && "InitArray() must be called before use.");
 #endif
+		SCRIPTARRAYSTL_COUNT_ACCESS();
 		pointer element = (pointer)m_as_array_ptr->At(index);
 		if(element == NULL)
 		{
 			throw std::out_of_range("pos out of range");
 		}
+		mark_dirty(index, index + 1);
 		return (*element);
 	}
 
 	// returns a constant reference to an element in the array. This will throw an out-of-range exception.
-	const_reference at(size_type) const
+	const_reference at(size_type index) const
 	{
 		// throws an exception if out of range
 		// since the array is actually being controlled by AngelScript, make sure we've been initialized first
 #ifdef ASSERT_IF_UNITIALIZED
 		assert((m_as_array_ptr != NULL) && "InitArray() must be called before use.");
 #endif
+		SCRIPTARRAYSTL_COUNT_ACCESS();
 		const_pointer element = (const_pointer)m_as_array_ptr->At(index);
 		if(element == NULL)
 		{
@@ -453,6 +1218,8 @@ public:
 #ifdef ASSERT_IF_UNITIALIZED
 		assert((m_as_array_ptr != NULL) && "InitArray() must be called before use.");
 #endif
+		SCRIPTARRAYSTL_TRACK_CHANGES();
+		SCRIPTARRAYSTL_COUNT_COPY(1);
 		m_as_array_ptr->InsertLast((void *)&val);
 	}
 
@@ -463,25 +1230,38 @@ public:
 	}
 
 	// assigns new data to the array using iterators.
+	// forward iterators size the array once and copy the range in a single pass. Use
+	// std::make_move_iterator() to move the elements out of the source instead of copying them.
 	template <class InputIterator>
-	void assign (InputIterator first, InputIterator last)
+	void assign (InputIterator first, InputIterator last,
+		typename std::enable_if<!std::is_integral<InputIterator>::value>::type * = 0)
 	{
-		resize(0);
-		for(auto it = first; it < last; it++)
-		{
-			push_back(*it);
-		}
+		assign_range(first, last, typename std::iterator_traits<InputIterator>::iterator_category());
 	}
 
 	// fills the array 
 	void assign (size_type n, const value_type& val)
 	{
+		if(n == 0)
+		{
+			clear();
+			return;
+		}
+
+		// val may be one of the elements released below, so it is copied and referenced first
+		value_type copy(val);
+		this->addref_values(&copy, &copy + 1);
+		this->release_range(0, size());
 		resize(n);
+		SCRIPTARRAYSTL_COUNT_COPY(n);
 
 		for(size_type i = 0; i < n; ++i)
 		{
-			(*this)[i] = val;
+			(*this)[i] = copy;
 		}
+
+		// the first element holds the reference added above
+		this->addref_range(1, n);
 	}
 
 	// clears the contents of the array
@@ -490,7 +1270,527 @@ public:
 		resize(0);
 	}
 
+	// inserts the elements in [first, last) before pos and returns an iterator to the first
+	// inserted element. The array is resized once and the existing elements are shifted once.
+	template <class InputIterator>
+	iterator insert (const_iterator pos, InputIterator first, InputIterator last,
+		typename std::enable_if<!std::is_integral<InputIterator>::value>::type * = 0)
+	{
+		size_type index = (size_type)(pos - cbegin());
+		insert_range(index, first, last, typename std::iterator_traits<InputIterator>::iterator_category());
+		return begin() + index;
+	}
+
+	// adds the elements in [first, last) to the end of the array
+	template <class InputIterator>
+	void append (InputIterator first, InputIterator last)
+	{
+		insert_range(size(), first, last, typename std::iterator_traits<InputIterator>::iterator_category());
+	}
+
+	// Change Tracking ----------------------------------------------------------------------------
+	// With CScriptArrayTracked as the array class, the elements changed through this object are
+	// recorded: everything written through operator[], at(), front() and back() (which includes
+	// reading through a non-const object), and everything changed by assign, insert, append,
+	// push_back, resize and the sorting members. Writes through iterators or data() of
+	// contiguous element types aren't seen and have to be recorded with mark_dirty().
+	// Other array classes don't record anything.
+
+	// records that the elements in [first, last) have changed
+	void mark_dirty(size_type first, size_type last)
+	{
+		CScriptArraySTL_tracker<TArrayClass>::MarkDirty(m_as_array_ptr, first, last);
+	}
+
+	// Returns the ranges of elements that changed since the last call, sorted and merged, and
+	// starts recording again. Arrays that don't record changes return the whole array.
+	std::vector<SScriptArraySTLRange> consume_dirty_ranges()
+	{
+#ifdef ASSERT_IF_UNITIALIZED
+		assert((m_as_array_ptr != NULL) && "InitArray() must be called before use.");
+#endif
+		return CScriptArraySTL_tracker<TArrayClass>::ConsumeDirtyRanges(m_as_array_ptr);
+	}
+
+	// Sorting and Searching --------------------------------------------------------------------
+	// These run natively on the buffer instead of going through the script array's generic
+	// comparisons. Elements that the array stores as pointers (strings and other objects) are
+	// sorted by moving the pointers, so the objects themselves are never copied.
+	// Arrays with SCRIPTARRAYSTL_PARALLEL_SORT_THRESHOLD or more elements are sorted on several
+	// threads, so the comparison must be safe to call from other threads and must not throw.
+
+	// sorts the array in ascending order
+	void sort()
+	{
+		sort(std::less<value_type>());
+	}
+
+	template <class Compare>
+	void sort(Compare comp)
+	{
+		sort_elements(comp, false, contiguous_tag());
+		mark_dirty(0, size());
+	}
+
+	// sorts the array keeping equal elements in their original order
+	void stable_sort()
+	{
+		stable_sort(std::less<value_type>());
+	}
+
+	template <class Compare>
+	void stable_sort(Compare comp)
+	{
+		sort_elements(comp, true, contiguous_tag());
+		mark_dirty(0, size());
+	}
+
+	// returns the position of the first element that isn't less than val. The array must be sorted.
+	iterator lower_bound(const value_type &val)
+	{
+		return lower_bound(val, std::less<value_type>());
+	}
+
+	template <class Compare>
+	iterator lower_bound(const value_type &val, Compare comp)
+	{
+		return begin() + find_lower_bound(val, comp, contiguous_tag());
+	}
+
+	const_iterator lower_bound(const value_type &val) const
+	{
+		return lower_bound(val, std::less<value_type>());
+	}
+
+	template <class Compare>
+	const_iterator lower_bound(const value_type &val, Compare comp) const
+	{
+		return cbegin() + const_cast<CScriptArraySTL *>(this)->find_lower_bound(val, comp, contiguous_tag());
+	}
+
+	// removes all but the first of each run of equal elements and returns the number removed
+	size_type unique()
+	{
+		return unique(std::equal_to<value_type>());
+	}
+
+	template <class BinaryPredicate>
+	size_type unique(BinaryPredicate pred)
+	{
+		size_type old_size = size();
+		resize(unique_elements(pred, contiguous_tag()));
+		mark_dirty(0, size());
+		return old_size - size();
+	}
+
+	// Reorders the array so the element at n is the one that would be there if the array was
+	// sorted, with nothing after it less than it and nothing before it greater than it.
+	void nth_element(size_type n)
+	{
+		nth_element(n, std::less<value_type>());
+	}
+
+	template <class Compare>
+	void nth_element(size_type n, Compare comp)
+	{
+		if(n >= size()) return;
+		nth_element_of(n, comp, contiguous_tag());
+		mark_dirty(0, size());
+	}
+
+#ifdef SCRIPTARRAYSTL_INSTRUMENT
+	// Instrumentation ----------------------------------------------------------------------------
+	// returns the counters for the work done through this object. They belong to the
+	// CScriptArraySTL object and aren't shared with copies or moved to other objects.
+	const SScriptArraySTLStats &GetStats() const
+	{
+		return m_stats;
+	}
+
+	void ResetStats()
+	{
+		m_stats = SScriptArraySTLStats();
+	}
+#endif
+
 private:
+	typedef std::integral_constant<bool, is_contiguous> contiguous_tag;
+
+	static void CheckElementType(asIObjectType *t)
+	{
+		// contiguous element types are accessed directly in the buffer, so the script type
+		// must also be one that the array stores inline (a primitive or a handle)
+		assert((!is_contiguous || !(t->GetSubTypeId() & asTYPEID_MASK_OBJECT) || (t->GetSubTypeId() & asTYPEID_OBJHANDLE))
+			&& "Element type is not stored contiguously by the script array.");
+		(void)t;
+	}
+
+	// contiguous element types point straight into the buffer
+	iterator make_iterator(size_type pos, std::true_type)
+	{
+		return data() + pos;
+	}
+	const_iterator make_iterator(size_type pos, std::true_type) const
+	{
+		return data() + pos;
+	}
+	// everything else goes through operator[]
+	iterator make_iterator(size_type pos, std::false_type)
+	{
+		return iterator(this, pos);
+	}
+	const_iterator make_iterator(size_type pos, std::false_type) const
+	{
+		return const_iterator(this, pos);
+	}
+
+	// single pass ranges can't be measured up front so they fall back to push_back
+	template <class InputIterator>
+	void assign_range(InputIterator first, InputIterator last, std::input_iterator_tag)
+	{
+		resize(0);
+		for(; first != last; ++first)
+		{
+			push_back(*first);
+		}
+	}
+
+	template <class ForwardIterator>
+	void assign_range(ForwardIterator first, ForwardIterator last, std::forward_iterator_tag)
+	{
+		size_type n = (size_type)std::distance(first, last);
+		if(n > 0 && is_own_iterator(first))
+		{
+			// the range would be overwritten while it is copied, so copy it out first
+			std::vector<value_type> tmp(first, last);
+			assign_range(std::make_move_iterator(tmp.begin()), std::make_move_iterator(tmp.end()), std::forward_iterator_tag());
+			return;
+		}
+
+		// handles in the range get their references before the old handles are released, in
+		// case this array is the only thing keeping them alive
+		this->addref_values(first, last);
+		this->release_range(0, size());
+		resize(n);
+		SCRIPTARRAYSTL_COUNT_COPY(n);
+		copy_range(0, first, last, n);
+		mark_dirty(0, n);
+	}
+
+	template <class InputIterator>
+	void insert_range(size_type index, InputIterator first, InputIterator last, std::input_iterator_tag)
+	{
+		// buffer the range so the array only has to be resized once
+		std::vector<value_type> tmp(first, last);
+		insert_range(index, std::make_move_iterator(tmp.begin()), std::make_move_iterator(tmp.end()), std::forward_iterator_tag());
+	}
+
+	template <class ForwardIterator>
+	void insert_range(size_type index, ForwardIterator first, ForwardIterator last, std::forward_iterator_tag)
+	{
+		size_type n = (size_type)std::distance(first, last);
+		size_type old_size = size();
+		if(n == 0) return;
+
+		if(is_own_iterator(first))
+		{
+			// resizing and shifting the array would move the range, so copy it out first
+			std::vector<value_type> tmp(first, last);
+			insert_range(index, std::make_move_iterator(tmp.begin()), std::make_move_iterator(tmp.end()), std::forward_iterator_tag());
+			return;
+		}
+
+		resize(old_size + n);
+		if(index < old_size)
+		{
+			// make room for the new elements
+			iterator it = begin();
+			std::move_backward(it + index, it + old_size, it + old_size + n);
+		}
+		SCRIPTARRAYSTL_COUNT_COPY(n);
+		copy_range(index, first, last, n);
+		this->addref_range(index, index + n);
+		mark_dirty(index, old_size + n);
+	}
+
+	// true if it is one of this array's own iterators
+	template <class Iterator>
+	bool is_own_iterator(Iterator) const
+	{
+		return false;
+	}
+	bool is_own_iterator(iterator it) const
+	{
+		return points_into(it, contiguous_tag());
+	}
+	bool is_own_iterator(const_iterator it) const
+	{
+		return points_into(it, contiguous_tag());
+	}
+
+	template <class Pointer>
+	bool points_into(Pointer p, std::true_type) const
+	{
+		return !std::less<const_pointer>()(p, data()) && std::less<const_pointer>()(p, data() + size());
+	}
+	template <class Iterator>
+	bool points_into(Iterator it, std::false_type) const
+	{
+		return it.container() == this;
+	}
+
+	// copies n elements into the array starting at index. The array must already be big enough.
+	template <class ForwardIterator>
+	void copy_range(size_type index, ForwardIterator first, ForwardIterator last, size_type n)
+	{
+		typedef typename std::remove_cv<typename std::remove_pointer<ForwardIterator>::type>::type source_type;
+
+		copy_range(index, first, last, n, std::integral_constant<bool,
+			is_contiguous && std::is_trivially_copyable<value_type>::value &&
+			std::is_pointer<ForwardIterator>::value && std::is_same<source_type, value_type>::value>());
+	}
+
+	// the source is a contiguous run of the same trivially copyable type, so copy it as one block
+	template <class ForwardIterator>
+	void copy_range(size_type index, ForwardIterator first, ForwardIterator, size_type n, std::true_type)
+	{
+		if(n > 0) memcpy(data() + index, first, n * sizeof(value_type));
+	}
+
+	template <class ForwardIterator>
+	void copy_range(size_type index, ForwardIterator first, ForwardIterator last, size_type, std::false_type)
+	{
+		std::copy(first, last, begin() + index);
+	}
+
+	// contiguous element types are indexed directly in the buffer without At()'s bounds check
+	reference element(size_type index, std::true_type)
+	{
+		return data()[index];
+	}
+	const_reference element(size_type index, std::true_type) const
+	{
+		return data()[index];
+	}
+	reference element(size_type index, std::false_type)
+	{
+		return *(pointer)m_as_array_ptr->At((asUINT)index);
+	}
+	const_reference element(size_type index, std::false_type) const
+	{
+		return *(const_pointer)m_as_array_ptr->At((asUINT)index);
+	}
+
+	// compares the objects behind the pointers the script array stores for non-contiguous types
+	template <class Compare>
+	struct indirect_compare
+	{
+		Compare comp;
+
+		explicit indirect_compare(Compare c) : comp(c) {}
+		bool operator () (const value_type *a, const value_type *b) { return comp(*a, *b); }
+	};
+
+	value_type **slots()
+	{
+		return (value_type **)m_as_array_ptr->GetBuffer();
+	}
+
+	template <class Compare>
+	void sort_elements(Compare comp, bool stable, std::true_type)
+	{
+		sort_range(data(), data() + size(), comp, stable);
+	}
+
+	template <class Compare>
+	void sort_elements(Compare comp, bool stable, std::false_type)
+	{
+		sort_range(slots(), slots() + size(), indirect_compare<Compare>(comp), stable);
+	}
+
+	// sorts on the calling thread, or sorts chunks on separate threads and merges them
+	template <class RandomIt, class Compare>
+	static void sort_range(RandomIt first, RandomIt last, Compare comp, bool stable)
+	{
+		size_t n = (size_t)(last - first);
+		size_t chunks = 1;
+		if(n >= SCRIPTARRAYSTL_PARALLEL_SORT_THRESHOLD)
+		{
+			size_t threads = std::thread::hardware_concurrency();
+			while(chunks * 2 <= threads) chunks *= 2;
+		}
+
+		auto sort_chunk = [comp, stable](RandomIt b, RandomIt e)
+		{
+			if(stable) std::stable_sort(b, e, comp);
+			else std::sort(b, e, comp);
+		};
+
+		if(chunks == 1)
+		{
+			sort_chunk(first, last);
+			return;
+		}
+
+		std::vector<RandomIt> bounds(chunks + 1);
+		for(size_t i = 0; i <= chunks; ++i) bounds[i] = first + (n * i / chunks);
+
+		std::vector<std::thread> workers;
+		for(size_t i = 1; i < chunks; ++i) workers.push_back(std::thread(sort_chunk, bounds[i], bounds[i + 1]));
+		sort_chunk(bounds[0], bounds[1]);
+		for(size_t i = 0; i < workers.size(); ++i) workers[i].join();
+
+		// merge neighbouring runs, which keeps equal elements in order for stable_sort
+		for(size_t width = 1; width < chunks; width *= 2)
+		{
+			workers.clear();
+			for(size_t i = 2 * width; i < chunks; i += 2 * width)
+			{
+				workers.push_back(std::thread([comp](RandomIt b, RandomIt m, RandomIt e) { std::inplace_merge(b, m, e, comp); },
+					bounds[i], bounds[i + width], bounds[std::min(i + 2 * width, chunks)]));
+			}
+			std::inplace_merge(bounds[0], bounds[width], bounds[std::min(2 * width, chunks)], comp);
+			for(size_t i = 0; i < workers.size(); ++i) workers[i].join();
+		}
+	}
+
+	template <class Compare>
+	size_type find_lower_bound(const value_type &val, Compare comp, std::true_type)
+	{
+		return (size_type)(std::lower_bound(data(), data() + size(), val, comp) - data());
+	}
+
+	template <class Compare>
+	size_type find_lower_bound(const value_type &val, Compare comp, std::false_type)
+	{
+		return (size_type)(std::lower_bound(slots(), slots() + size(), &val, indirect_compare<Compare>(comp)) - slots());
+	}
+
+	// both return the number of elements to keep
+	template <class BinaryPredicate>
+	size_type unique_elements(BinaryPredicate pred, std::true_type)
+	{
+		// handles have to be released, so they are treated like the stored object pointers
+		if(std::is_pointer<value_type>::value) return unique_by_swapping(data(), pred);
+		return (size_type)(std::unique(data(), data() + size(), pred) - data());
+	}
+
+	template <class BinaryPredicate>
+	size_type unique_elements(BinaryPredicate pred, std::false_type)
+	{
+		return unique_by_swapping(slots(), indirect_compare<BinaryPredicate>(pred));
+	}
+
+	// std::unique would leave copies of the kept pointers at the end, which the array would then
+	// destroy, so duplicates are swapped to the end instead
+	template <class Pointer, class BinaryPredicate>
+	size_type unique_by_swapping(Pointer *p, BinaryPredicate pred)
+	{
+		size_type n = size();
+		if(n == 0) return 0;
+
+		size_type kept = 1;
+		for(size_type i = 1; i < n; ++i)
+		{
+			if(!pred(p[kept - 1], p[i]))
+			{
+				std::swap(p[kept], p[i]);
+				++kept;
+			}
+		}
+		return kept;
+	}
+
+	template <class Compare>
+	void nth_element_of(size_type n, Compare comp, std::true_type)
+	{
+		std::nth_element(data(), data() + n, data() + size(), comp);
+	}
+
+	template <class Compare>
+	void nth_element_of(size_type n, Compare comp, std::false_type)
+	{
+		std::nth_element(slots(), slots() + n, slots() + size(), indirect_compare<Compare>(comp));
+	}
+
+#ifdef SCRIPTARRAYSTL_INSTRUMENT
+	// records what a resize, reserve or push_back did to the buffer when it goes out of scope
+	class change_tracker
+	{
+	public:
+		explicit change_tracker(const CScriptArraySTL &a)
+			:m_array(a), m_size(a.size()), m_capacity(CScriptArraySTL_buffer_access::Capacity(a.m_as_array_ptr)),
+			m_buffer(const_cast<TArrayClass *>(a.m_as_array_ptr)->GetBuffer())
+		{
+		}
+
+		~change_tracker()
+		{
+			m_array.record_change(m_size, m_capacity, m_buffer);
+		}
+
+	private:
+		change_tracker(const change_tracker &);
+		change_tracker &operator = (const change_tracker &);
+
+		const CScriptArraySTL &m_array;
+		size_type m_size;
+		asUINT m_capacity;
+		void *m_buffer;
+	};
+
+	SScriptArraySTLTypeStats *type_stats() const
+	{
+		// looked up again only when the object is given an array of another type
+		asIObjectType *t = m_as_array_ptr->GetArrayObjectType();
+		if(t != m_stats_type)
+		{
+			m_type_stats = CScriptArraySTLStats::ForType(t);
+			m_stats_type = t;
+		}
+		return m_type_stats;
+	}
+
+	void count(const SScriptArraySTLStats &delta) const
+	{
+		m_stats.Add(delta);
+		type_stats()->Add(delta);
+	}
+
+	void count_access() const
+	{
+		++m_stats.element_accesses;
+		type_stats()->element_accesses.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void count_copy(size_type n) const
+	{
+		SScriptArraySTLStats delta;
+		delta.bytes_copied = n * sizeof(value_type);
+		count(delta);
+	}
+
+	void record_change(size_type old_size, asUINT old_capacity, void *old_buffer) const
+	{
+		asUINT capacity = CScriptArraySTL_buffer_access::Capacity(m_as_array_ptr);
+
+		SScriptArraySTLStats delta;
+		if(capacity != old_capacity || const_cast<TArrayClass *>(m_as_array_ptr)->GetBuffer() != old_buffer)
+		{
+			// the elements already in the array were moved. Object types are moved as pointers.
+			delta.reallocations = 1;
+			delta.bytes_copied = old_size * (is_contiguous ? sizeof(value_type) : sizeof(void *));
+		}
+		if(size() > old_size) delta.growth_events = 1;
+		delta.peak_capacity = capacity;
+		count(delta);
+	}
+
+	mutable SScriptArraySTLStats m_stats;
+	mutable SScriptArraySTLTypeStats *m_type_stats = NULL;
+	mutable asIObjectType *m_stats_type = NULL;
+#endif
+
 	TArrayClass *m_as_array_ptr; // Reference counted within AngelScript
 };
 
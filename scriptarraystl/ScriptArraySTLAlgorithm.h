@@ -0,0 +1,209 @@
+// Native sorting and searching for script arrays.
+// RegisterScriptArraySTLAlgorithms() adds these methods to array<T>:
+//     void sort(bool ascending = true)
+//     void stableSort(bool ascending = true)
+//     int lowerBound(const T &in value, bool ascending = true) const
+//     uint unique()
+//     void nthElement(uint n, bool ascending = true)
+// For arrays of the primitive types and of string they run the CScriptArraySTL algorithms
+// directly on the array's buffer instead of going through the engine's generic comparisons.
+// For other element types sort() and nthElement() fall back to sortAsc()/sortDesc(), which call
+// the type's opCmp, and the other methods raise a script exception.
+// lowerBound() returns the index of the first element that isn't ordered before value. The
+// array must already be sorted in the same direction.
+// float and double NaNs are ordered after every other value in both directions.
+// The string add-on must be registered before the array<string> methods can be used, and
+// RegisterScriptArray() must be called before RegisterScriptArraySTLAlgorithms().
+// Copyright (c) 2014, Dominque A Douglas
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+//    in the documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+// OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <string.h>
+#include <string>
+
+#include "ScriptArraySTL.h"
+
+// orderings used by the script methods. Floating point NaNs are put last in both directions,
+// since the plain operators don't give a strict weak ordering when NaNs are present.
+template <class T>
+struct CScriptArraySTL_script_order
+{
+	static bool less(const T &a, const T &b)    { return a < b; }
+	static bool greater(const T &a, const T &b) { return b < a; }
+};
+
+template <class T>
+struct CScriptArraySTL_script_float_order
+{
+	static bool less(const T &a, const T &b)    { return a < b || (b != b && a == a); }
+	static bool greater(const T &a, const T &b) { return b < a || (b != b && a == a); }
+};
+
+template <> struct CScriptArraySTL_script_order<float> : CScriptArraySTL_script_float_order<float> {};
+template <> struct CScriptArraySTL_script_order<double> : CScriptArraySTL_script_float_order<double> {};
+
+struct CScriptArraySTL_algorithm_binding
+{
+	static void SetException(const char *message)
+	{
+		asIScriptContext *ctx = asGetActiveContext();
+		if(ctx) ctx->SetException(message);
+	}
+
+	template <class T>
+	struct Order
+	{
+		bool ascending;
+
+		explicit Order(bool asc) : ascending(asc) {}
+		bool operator () (const T &a, const T &b) const
+		{
+			return ascending ? CScriptArraySTL_script_order<T>::less(a, b) : CScriptArraySTL_script_order<T>::greater(a, b);
+		}
+	};
+
+	// Calls F::template Run<T> with the C++ type of the array's elements. Returns false if the
+	// element type has no native implementation.
+	template <class F>
+	static bool Dispatch(asIScriptGeneric *gen)
+	{
+		CScriptArray *self = (CScriptArray *)gen->GetObject();
+		switch(self->GetElementTypeId())
+		{
+		case asTYPEID_BOOL:   F::template Run<bool>(gen, self); return true;
+		case asTYPEID_INT8:   F::template Run<signed char>(gen, self); return true;
+		case asTYPEID_INT16:  F::template Run<short>(gen, self); return true;
+		case asTYPEID_INT32:  F::template Run<int>(gen, self); return true;
+		case asTYPEID_INT64:  F::template Run<long long>(gen, self); return true;
+		case asTYPEID_UINT8:  F::template Run<unsigned char>(gen, self); return true;
+		case asTYPEID_UINT16: F::template Run<unsigned short>(gen, self); return true;
+		case asTYPEID_UINT32: F::template Run<unsigned int>(gen, self); return true;
+		case asTYPEID_UINT64: F::template Run<unsigned long long>(gen, self); return true;
+		case asTYPEID_FLOAT:  F::template Run<float>(gen, self); return true;
+		case asTYPEID_DOUBLE: F::template Run<double>(gen, self); return true;
+		}
+
+		// Only an element type that looks like the string add-on's is checked against the type
+		// cache, so arrays of other types don't repeat a lookup that fails when string isn't
+		// registered.
+		asIObjectType *sub_type = self->GetArrayObjectType()->GetSubType();
+		if(sub_type != NULL && !(self->GetElementTypeId() & asTYPEID_OBJHANDLE) &&
+			(sub_type->GetFlags() & asOBJ_VALUE) && sub_type->GetSize() == sizeof(std::string) &&
+			strcmp(sub_type->GetName(), "string") == 0 &&
+			self->GetArrayObjectType() == CScriptArraySTLTypeCache::GetArrayType<std::string>(gen->GetEngine()))
+		{
+			F::template Run<std::string>(gen, self);
+			return true;
+		}
+		return false;
+	}
+
+	struct Sort
+	{
+		template <class T> static void Run(asIScriptGeneric *gen, CScriptArray *self)
+		{
+			CScriptArraySTL<T> a(self);
+			a.sort(Order<T>(gen->GetArgByte(0) != 0));
+		}
+	};
+
+	struct StableSort
+	{
+		template <class T> static void Run(asIScriptGeneric *gen, CScriptArray *self)
+		{
+			CScriptArraySTL<T> a(self);
+			a.stable_sort(Order<T>(gen->GetArgByte(0) != 0));
+		}
+	};
+
+	struct LowerBound
+	{
+		template <class T> static void Run(asIScriptGeneric *gen, CScriptArray *self)
+		{
+			CScriptArraySTL<T> a(self);
+			const T &value = *(const T *)gen->GetArgAddress(0);
+			gen->SetReturnDWord((asDWORD)(a.lower_bound(value, Order<T>(gen->GetArgByte(1) != 0)) - a.begin()));
+		}
+	};
+
+	struct Unique
+	{
+		template <class T> static void Run(asIScriptGeneric *gen, CScriptArray *self)
+		{
+			CScriptArraySTL<T> a(self);
+			gen->SetReturnDWord((asDWORD)a.unique());
+		}
+	};
+
+	struct NthElement
+	{
+		template <class T> static void Run(asIScriptGeneric *gen, CScriptArray *self)
+		{
+			CScriptArraySTL<T> a(self);
+			a.nth_element(gen->GetArgDWord(0), Order<T>(gen->GetArgByte(1) != 0));
+		}
+	};
+
+	static void ScriptSort(asIScriptGeneric *gen)
+	{
+		if(Dispatch<Sort>(gen)) return;
+
+		CScriptArray *self = (CScriptArray *)gen->GetObject();
+		if(gen->GetArgByte(0) != 0) self->SortAsc();
+		else self->SortDesc();
+	}
+
+	static void ScriptStableSort(asIScriptGeneric *gen)
+	{
+		if(!Dispatch<StableSort>(gen)) SetException("stableSort() is not supported for this element type");
+	}
+
+	static void ScriptLowerBound(asIScriptGeneric *gen)
+	{
+		if(!Dispatch<LowerBound>(gen)) SetException("lowerBound() is not supported for this element type");
+	}
+
+	static void ScriptUnique(asIScriptGeneric *gen)
+	{
+		if(!Dispatch<Unique>(gen)) SetException("unique() is not supported for this element type");
+	}
+
+	static void ScriptNthElement(asIScriptGeneric *gen)
+	{
+		if(Dispatch<NthElement>(gen)) return;
+
+		// a full sort also puts the nth element in place
+		CScriptArray *self = (CScriptArray *)gen->GetObject();
+		if(gen->GetArgByte(1) != 0) self->SortAsc();
+		else self->SortDesc();
+	}
+};
+
+// Registers the native algorithms as methods of array<T>. RegisterScriptArray() must be called first.
+inline int RegisterScriptArraySTLAlgorithms(asIScriptEngine *engine)
+{
+	typedef CScriptArraySTL_algorithm_binding B;
+	int r;
+
+	r = engine->RegisterObjectMethod("array<T>", "void sort(bool ascending = true)", asFUNCTION(B::ScriptSort), asCALL_GENERIC); if(r < 0) return r;
+	r = engine->RegisterObjectMethod("array<T>", "void stableSort(bool ascending = true)", asFUNCTION(B::ScriptStableSort), asCALL_GENERIC); if(r < 0) return r;
+	r = engine->RegisterObjectMethod("array<T>", "int lowerBound(const T &in value, bool ascending = true) const", asFUNCTION(B::ScriptLowerBound), asCALL_GENERIC); if(r < 0) return r;
+	r = engine->RegisterObjectMethod("array<T>", "uint unique()", asFUNCTION(B::ScriptUnique), asCALL_GENERIC); if(r < 0) return r;
+	r = engine->RegisterObjectMethod("array<T>", "void nthElement(uint n, bool ascending = true)", asFUNCTION(B::ScriptNthElement), asCALL_GENERIC); if(r < 0) return r;
+
+	return 0;
+}
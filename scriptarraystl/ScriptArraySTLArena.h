@@ -0,0 +1,261 @@
+// Arena backed script arrays for temporary per-frame or per-context data.
+// CScriptArraySTLArena is a bump allocator that script array buffers can be allocated from. While
+// a CScriptArraySTLSourceScope for an arena is alive, every array buffer allocated on that thread
+// comes from the arena, including arrays that scripts create if the scope is wrapped around the
+// script call. Freeing a block only updates the statistics (or rolls back the top of the arena if
+// it was the last block), and Reset() makes all of the memory available again at once.
+// CScriptArrayArena can be used as the TArrayClass of CScriptArraySTL. To scripts it is a normal
+// array<T>. It remembers the arena it was created with so that growing it from C++ later still
+// allocates from that arena.
+// CScriptArraySTLMemory::Install() must have been called before any of this is used.
+//
+// Example:
+//     CScriptArraySTLArena arena;
+//     {
+//         CScriptArraySTLSourceScope scope(&arena);
+//         CScriptArraySTL<float, CScriptArrayArena> samples;
+//         samples.InitArray(engine, 256);
+//         ... call the script with samples.GetRef() ...
+//     }
+//     arena.Reset(); // at the end of the tick
+// Copyright (c) 2014, Dominque A Douglas
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+//    in the documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+// OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <stdlib.h>
+#include <new>
+#include <vector>
+
+#include "ScriptArraySTLMemory.h"
+
+// Allocation statistics for an arena
+struct SScriptArraySTLArenaStats
+{
+	size_t allocations;    // blocks allocated since the arena was created
+	size_t frees;          // blocks freed since the arena was created
+	size_t live_blocks;    // blocks that haven't been freed yet
+	size_t bytes_in_use;   // bytes used in the arena's chunks since the last reset
+	size_t peak_bytes;     // the highest bytes_in_use has been
+	size_t reserved_bytes; // memory held by the arena's chunks
+	size_t chunks;         // number of chunks
+	size_t resets;         // successful calls to Reset()
+	size_t failed_resets;  // calls to Reset() that were refused because blocks were still live
+};
+
+class CScriptArraySTLArena : public CScriptArraySTLBufferSource
+{
+public:
+	// chunk_size is the size of each chunk of memory requested from the heap. Blocks bigger than
+	// this get a chunk of their own.
+	explicit CScriptArraySTLArena(size_t chunk_size = 64 * 1024)
+		:m_chunk_size(chunk_size), m_current(0), m_top(0)
+	{
+		memset(&m_stats, 0, sizeof(m_stats));
+	}
+
+	~CScriptArraySTLArena()
+	{
+		assert((m_stats.live_blocks == 0) && "Arena destroyed while script arrays still use it.");
+		for(size_t i = 0; i < m_chunks.size(); ++i)
+		{
+			free(m_chunks[i].memory);
+		}
+	}
+
+	virtual void *AllocateBlock(size_t size)
+	{
+		size = AlignSize(size);
+
+		// move on to the next chunk that can hold the block
+		while(m_current < m_chunks.size() && m_top + size > m_chunks[m_current].size)
+		{
+			++m_current;
+			m_top = 0;
+		}
+
+		if(m_current == m_chunks.size())
+		{
+			SChunk chunk;
+			chunk.size = size > m_chunk_size ? size : m_chunk_size;
+			chunk.memory = (char *)malloc(chunk.size);
+			if(chunk.memory == NULL) return NULL;
+
+			m_chunks.push_back(chunk);
+			m_top = 0;
+			m_stats.chunks++;
+			m_stats.reserved_bytes += chunk.size;
+		}
+
+		void *block = m_chunks[m_current].memory + m_top;
+		m_top += size;
+
+		m_stats.allocations++;
+		m_stats.live_blocks++;
+		m_stats.bytes_in_use += size;
+		if(m_stats.bytes_in_use > m_stats.peak_bytes) m_stats.peak_bytes = m_stats.bytes_in_use;
+
+		return block;
+	}
+
+	virtual void FreeBlock(void *block, size_t size)
+	{
+		assert(m_stats.live_blocks > 0);
+		size = AlignSize(size);
+
+		m_stats.frees++;
+		m_stats.live_blocks--;
+
+		// if this was the last block allocated the space can be used again right away. This is
+		// common when an array grows, since the old buffer is freed just after the new one is made.
+		if(m_current < m_chunks.size() && (char *)block + size == m_chunks[m_current].memory + m_top)
+		{
+			m_top -= size;
+			m_stats.bytes_in_use -= size;
+		}
+	}
+
+	// Makes all of the arena's memory available again. Fails and returns false if any block is
+	// still in use, which means an array allocated from the arena is still alive.
+	bool Reset()
+	{
+		if(m_stats.live_blocks != 0)
+		{
+			m_stats.failed_resets++;
+			return false;
+		}
+
+		m_current = 0;
+		m_top = 0;
+		m_stats.bytes_in_use = 0;
+		m_stats.resets++;
+
+		return true;
+	}
+
+	// frees all chunks but the first. Only allowed when no blocks are in use.
+	bool Trim()
+	{
+		if(!Reset()) return false;
+
+		for(size_t i = 1; i < m_chunks.size(); ++i)
+		{
+			m_stats.reserved_bytes -= m_chunks[i].size;
+			free(m_chunks[i].memory);
+		}
+		if(m_chunks.size() > 1) m_chunks.resize(1);
+		m_stats.chunks = m_chunks.size();
+
+		return true;
+	}
+
+	const SScriptArraySTLArenaStats &GetStats() const
+	{
+		return m_stats;
+	}
+
+private:
+	struct SChunk
+	{
+		char   *memory;
+		size_t  size;
+	};
+
+	static size_t AlignSize(size_t size)
+	{
+		return (size + 15) & ~(size_t)15;
+	}
+
+	std::vector<SChunk>       m_chunks;
+	size_t                    m_chunk_size;
+	size_t                    m_current; // chunk that is being allocated from
+	size_t                    m_top;     // offset of the free space in the current chunk
+	SScriptArraySTLArenaStats m_stats;
+
+	CScriptArraySTLArena(const CScriptArraySTLArena &);
+	CScriptArraySTLArena &operator = (const CScriptArraySTLArena &);
+};
+
+// Script array that is allocated from the source that is current when it is created and keeps
+// allocating from it when it is grown from C++.
+class CScriptArrayArena : public CScriptArray
+{
+public:
+	CScriptArrayArena(asUINT length, asIObjectType *ot)
+		:CScriptArray(length, ot), m_source(CScriptArraySTLMemory::GetSource())
+	{
+		assert(CScriptArraySTLMemory::IsInstalled() && "CScriptArraySTLMemory::Install() must be called first.");
+	}
+
+	// the object itself also lives in the current source
+	static void *operator new(size_t size)
+	{
+		void *ptr = CScriptArraySTLMemory::Alloc(size);
+		if(ptr == NULL) throw std::bad_alloc();
+		return ptr;
+	}
+
+	static void operator delete(void *ptr)
+	{
+		CScriptArraySTLMemory::Free(ptr);
+	}
+
+	// these hide the CScriptArray versions so that growing the array through CScriptArraySTL
+	// allocates from the array's own source
+	void Resize(asUINT numElements)
+	{
+		CScriptArraySTLSourceScope scope(m_source);
+		CScriptArray::Resize(numElements);
+	}
+
+	void Reserve(asUINT maxElements)
+	{
+		CScriptArraySTLSourceScope scope(m_source);
+		CScriptArray::Reserve(maxElements);
+	}
+
+	void InsertAt(asUINT index, void *value)
+	{
+		CScriptArraySTLSourceScope scope(m_source);
+		Grow();
+		CScriptArray::InsertAt(index, value);
+	}
+
+	void InsertLast(void *value)
+	{
+		CScriptArraySTLSourceScope scope(m_source);
+		Grow();
+		CScriptArray::InsertLast(value);
+	}
+
+	CScriptArraySTLBufferSource *GetSource() const
+	{
+		return m_source;
+	}
+
+protected:
+	CScriptArraySTLBufferSource *m_source;
+
+	// CScriptArray grows the buffer by exactly one element when inserting into a full array.
+	// In an arena every old buffer stays allocated until the reset, so double the capacity instead.
+	void Grow()
+	{
+		if(buffer->numElements == buffer->maxElements)
+		{
+			CScriptArray::Reserve(buffer->maxElements < 4 ? 8 : buffer->maxElements * 2);
+		}
+	}
+};
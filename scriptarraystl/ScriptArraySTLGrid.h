@@ -0,0 +1,557 @@
+// Two and three dimensional views of flat script arrays.
+// Heightmaps, occupancy grids and volumes are usually kept in a flat array<T> in row-major order
+// so that scripts can pass them around as one object. CScriptArraySTLGrid2D and
+// CScriptArraySTLGrid3D look at such an array as a grid without copying it. A view holds a
+// pointer to its first cell, its extents and its strides, so sub() can return a rectangle or box
+// inside a larger grid that shares the same elements.
+// Every row of a view is contiguous. row() returns a pointer to the start of a row and the
+// for_each functions walk each row with a plain pointer, or the whole view in one walk if the
+// rows follow each other in memory. column() returns a strided iterator. for_each_tile() visits
+// the view in square tiles of about SCRIPTARRAYSTL_GRID_TILE_BYTES, so an operation that reads
+// neighbouring rows finds them in cache.
+// Only element types that are stored contiguously can be viewed. A view holds a raw pointer into
+// the array, so it is invalidated by anything that reallocates the array, and writes through it
+// aren't seen by change tracking.
+//
+// RegisterScriptArraySTLGrid() adds these methods to array<T> so scripts can do the same without
+// computing indexes in bytecode:
+//     T &cell(uint x, uint y, uint width)
+//     const T &cell(uint x, uint y, uint width) const
+//     T &cell(uint x, uint y, uint z, uint width, uint height)
+//     const T &cell(uint x, uint y, uint z, uint width, uint height) const
+//     void fillRect(uint x, uint y, uint w, uint h, uint width, const T &in value)
+// They work for every element type and raise a script exception if a coordinate is outside the
+// grid or the array is too small for it.
+//
+// Example:
+//     CScriptArraySTL<float> heights(script_heights);
+//     CScriptArraySTLGrid2D<float> grid(heights, 256, 256);
+//     grid.sub(64, 64, 32, 32).fill(0.0f);
+//     grid.for_each_tile([](CScriptArraySTLGrid2D<float> tile, size_t x, size_t y) { ... });
+// Copyright (c) 2014, Dominque A Douglas
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+//    in the documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+// OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <stddef.h>
+#include <string.h>
+#include <algorithm>
+#include <iterator>
+
+#include "ScriptArraySTL.h"
+
+// bytes of elements in each tile visited by for_each_tile()
+#ifndef SCRIPTARRAYSTL_GRID_TILE_BYTES
+#define SCRIPTARRAYSTL_GRID_TILE_BYTES 16384
+#endif
+
+// random access iterator that steps over a fixed number of elements, used for columns
+template <class T>
+class CScriptArraySTLGridStrideIterator
+{
+public:
+	typedef std::random_access_iterator_tag iterator_category;
+	typedef typename std::remove_const<T>::type value_type;
+	typedef ptrdiff_t difference_type;
+	typedef T *pointer;
+	typedef T &reference;
+
+	CScriptArraySTLGridStrideIterator() : m_ptr(NULL), m_stride(0) {}
+	CScriptArraySTLGridStrideIterator(T *ptr, ptrdiff_t stride) : m_ptr(ptr), m_stride(stride) {}
+
+	reference operator * () const { return *m_ptr; }
+	pointer operator -> () const { return m_ptr; }
+	reference operator [] (difference_type n) const { return m_ptr[n * m_stride]; }
+
+	CScriptArraySTLGridStrideIterator &operator ++ () { m_ptr += m_stride; return *this; }
+	CScriptArraySTLGridStrideIterator &operator -- () { m_ptr -= m_stride; return *this; }
+	CScriptArraySTLGridStrideIterator operator ++ (int) { CScriptArraySTLGridStrideIterator t(*this); m_ptr += m_stride; return t; }
+	CScriptArraySTLGridStrideIterator operator -- (int) { CScriptArraySTLGridStrideIterator t(*this); m_ptr -= m_stride; return t; }
+	CScriptArraySTLGridStrideIterator &operator += (difference_type n) { m_ptr += n * m_stride; return *this; }
+	CScriptArraySTLGridStrideIterator &operator -= (difference_type n) { m_ptr -= n * m_stride; return *this; }
+	CScriptArraySTLGridStrideIterator operator + (difference_type n) const { return CScriptArraySTLGridStrideIterator(m_ptr + n * m_stride, m_stride); }
+	CScriptArraySTLGridStrideIterator operator - (difference_type n) const { return CScriptArraySTLGridStrideIterator(m_ptr - n * m_stride, m_stride); }
+	friend CScriptArraySTLGridStrideIterator operator + (difference_type n, const CScriptArraySTLGridStrideIterator &it) { return it + n; }
+	difference_type operator - (const CScriptArraySTLGridStrideIterator &other) const { return (m_ptr - other.m_ptr) / m_stride; }
+
+	bool operator == (const CScriptArraySTLGridStrideIterator &other) const { return m_ptr == other.m_ptr; }
+	bool operator != (const CScriptArraySTLGridStrideIterator &other) const { return m_ptr != other.m_ptr; }
+	bool operator < (const CScriptArraySTLGridStrideIterator &other) const { return (m_ptr - other.m_ptr) * m_stride < 0; }
+	bool operator > (const CScriptArraySTLGridStrideIterator &other) const { return other < *this; }
+	bool operator <= (const CScriptArraySTLGridStrideIterator &other) const { return !(other < *this); }
+	bool operator >= (const CScriptArraySTLGridStrideIterator &other) const { return !(*this < other); }
+
+private:
+	T        *m_ptr;
+	ptrdiff_t m_stride;
+};
+
+// side length, in elements, of the square tiles for_each_tile() uses for elements of type T
+template <class T>
+inline size_t ScriptArraySTL_GridTileSide()
+{
+	size_t elements = SCRIPTARRAYSTL_GRID_TILE_BYTES / sizeof(T);
+	size_t side = 1;
+	while(side * side * 4 <= elements) side *= 2;
+	return side;
+}
+
+// View of width * height cells. Cell (x, y) is at data()[y * stride() + x]. Use
+// CScriptArraySTLGrid2D<const T> to view a const array.
+template <class T>
+class CScriptArraySTLGrid2D
+{
+public:
+	typedef typename std::remove_const<T>::type value_type;
+	typedef T *row_iterator;
+	typedef CScriptArraySTLGridStrideIterator<T> column_iterator;
+
+	CScriptArraySTLGrid2D()
+		:m_data(NULL), m_width(0), m_height(0), m_stride(0)
+	{
+	}
+
+	// views the elements of a as a grid of width * height cells. a must have at least that many elements.
+	template <class A>
+	CScriptArraySTLGrid2D(CScriptArraySTL<value_type, A> &a, size_t width, size_t height)
+		:m_data(a.data()), m_width(width), m_height(height), m_stride(width)
+	{
+		assert(width * height <= a.size() && "The array is too small for the grid.");
+	}
+
+	template <class A>
+	CScriptArraySTLGrid2D(const CScriptArraySTL<value_type, A> &a, size_t width, size_t height)
+		:m_data(a.data()), m_width(width), m_height(height), m_stride(width)
+	{
+		assert(width * height <= a.size() && "The array is too small for the grid.");
+	}
+
+	// views memory that is already laid out as a grid. stride is the distance between rows in elements.
+	CScriptArraySTLGrid2D(T *data, size_t width, size_t height, size_t stride)
+		:m_data(data), m_width(width), m_height(height), m_stride(stride)
+	{
+		assert(stride >= width && "Rows can't overlap.");
+	}
+
+	// a view of the const elements
+	operator CScriptArraySTLGrid2D<const value_type> () const
+	{
+		return CScriptArraySTLGrid2D<const value_type>(m_data, m_width, m_height, m_stride);
+	}
+
+	size_t width() const  { return m_width; }
+	size_t height() const { return m_height; }
+	size_t stride() const { return m_stride; }
+	size_t size() const   { return m_width * m_height; }
+	bool empty() const    { return m_width == 0 || m_height == 0; }
+	T *data() const       { return m_data; }
+
+	// returns true if the rows follow each other in memory with no gaps
+	bool is_contiguous() const
+	{
+		return m_stride == m_width || m_height <= 1;
+	}
+
+	T &operator () (size_t x, size_t y) const
+	{
+		assert(x < m_width && y < m_height && "Grid coordinates out of range");
+		return m_data[y * m_stride + x];
+	}
+
+	// the cells of row y are row(y)[0] to row(y)[width() - 1]
+	T *row(size_t y) const
+	{
+		assert(y < m_height && "Grid row out of range");
+		return m_data + y * m_stride;
+	}
+
+	row_iterator row_begin(size_t y) const { return row(y); }
+	row_iterator row_end(size_t y) const   { return row(y) + m_width; }
+
+	column_iterator column_begin(size_t x) const
+	{
+		assert(x < m_width && "Grid column out of range");
+		return column_iterator(m_data + x, (ptrdiff_t)m_stride);
+	}
+
+	column_iterator column_end(size_t x) const
+	{
+		return column_begin(x) + (ptrdiff_t)m_height;
+	}
+
+	// view of the w * h cells starting at (x, y). It shares its elements with this view.
+	CScriptArraySTLGrid2D sub(size_t x, size_t y, size_t w, size_t h) const
+	{
+		assert(x + w <= m_width && y + h <= m_height && "Sub-grid out of range");
+		return CScriptArraySTLGrid2D(m_data + y * m_stride + x, w, h, m_stride);
+	}
+
+	// calls f(T *row, size_t y) for every row
+	template <class F>
+	void for_each_row(F f) const
+	{
+		T *p = m_data;
+		for(size_t y = 0; y < m_height; ++y, p += m_stride) f(p, y);
+	}
+
+	// calls f(T &) for every cell in row-major order
+	template <class F>
+	void for_each(F f) const
+	{
+		if(empty()) return;
+
+		if(is_contiguous())
+		{
+			for(T *p = m_data, *end = m_data + size(); p != end; ++p) f(*p);
+			return;
+		}
+
+		T *p = m_data;
+		for(size_t y = 0; y < m_height; ++y, p += m_stride)
+		{
+			for(T *q = p, *end = p + m_width; q != end; ++q) f(*q);
+		}
+	}
+
+	// calls f(CScriptArraySTLGrid2D tile, size_t x, size_t y) for tiles of at most
+	// tile_width * tile_height cells, where (x, y) is the tile's first cell in this view
+	template <class F>
+	void for_each_tile(size_t tile_width, size_t tile_height, F f) const
+	{
+		assert(tile_width > 0 && tile_height > 0 && "Tiles can't be empty");
+
+		for(size_t y = 0; y < m_height; y += tile_height)
+		{
+			size_t h = std::min(tile_height, m_height - y);
+			for(size_t x = 0; x < m_width; x += tile_width)
+			{
+				f(sub(x, y, std::min(tile_width, m_width - x), h), x, y);
+			}
+		}
+	}
+
+	// for_each_tile() with tiles sized to stay in the first level cache
+	template <class F>
+	void for_each_tile(F f) const
+	{
+		size_t side = ScriptArraySTL_GridTileSide<value_type>();
+		for_each_tile(side, side, f);
+	}
+
+	void fill(const value_type &value) const
+	{
+		for_each_row([this, &value](T *row, size_t) { std::fill(row, row + m_width, value); });
+	}
+
+	// copies the cells of src into this view. Both views must have the same extents and must not overlap.
+	template <class U>
+	void copy_from(const CScriptArraySTLGrid2D<U> &src) const
+	{
+		assert(src.width() == m_width && src.height() == m_height && "Grid sizes don't match");
+		for_each_row([&src, this](T *row, size_t y) { std::copy(src.row(y), src.row(y) + m_width, row); });
+	}
+
+private:
+	T     *m_data;
+	size_t m_width;
+	size_t m_height;
+	size_t m_stride;
+};
+
+// View of width * height * depth cells. Cell (x, y, z) is at
+// data()[z * slice_stride() + y * row_stride() + x].
+template <class T>
+class CScriptArraySTLGrid3D
+{
+public:
+	typedef typename std::remove_const<T>::type value_type;
+	typedef CScriptArraySTLGridStrideIterator<T> column_iterator;
+
+	CScriptArraySTLGrid3D()
+		:m_data(NULL), m_width(0), m_height(0), m_depth(0), m_row_stride(0), m_slice_stride(0)
+	{
+	}
+
+	// views the elements of a as a grid of width * height * depth cells
+	template <class A>
+	CScriptArraySTLGrid3D(CScriptArraySTL<value_type, A> &a, size_t width, size_t height, size_t depth)
+		:m_data(a.data()), m_width(width), m_height(height), m_depth(depth), m_row_stride(width), m_slice_stride(width * height)
+	{
+		assert(width * height * depth <= a.size() && "The array is too small for the grid.");
+	}
+
+	template <class A>
+	CScriptArraySTLGrid3D(const CScriptArraySTL<value_type, A> &a, size_t width, size_t height, size_t depth)
+		:m_data(a.data()), m_width(width), m_height(height), m_depth(depth), m_row_stride(width), m_slice_stride(width * height)
+	{
+		assert(width * height * depth <= a.size() && "The array is too small for the grid.");
+	}
+
+	CScriptArraySTLGrid3D(T *data, size_t width, size_t height, size_t depth, size_t row_stride, size_t slice_stride)
+		:m_data(data), m_width(width), m_height(height), m_depth(depth), m_row_stride(row_stride), m_slice_stride(slice_stride)
+	{
+		assert(row_stride >= width && slice_stride >= row_stride * height && "Rows and slices can't overlap.");
+	}
+
+	operator CScriptArraySTLGrid3D<const value_type> () const
+	{
+		return CScriptArraySTLGrid3D<const value_type>(m_data, m_width, m_height, m_depth, m_row_stride, m_slice_stride);
+	}
+
+	size_t width() const        { return m_width; }
+	size_t height() const       { return m_height; }
+	size_t depth() const        { return m_depth; }
+	size_t row_stride() const   { return m_row_stride; }
+	size_t slice_stride() const { return m_slice_stride; }
+	size_t size() const         { return m_width * m_height * m_depth; }
+	bool empty() const          { return m_width == 0 || m_height == 0 || m_depth == 0; }
+	T *data() const             { return m_data; }
+
+	bool is_contiguous() const
+	{
+		return (m_row_stride == m_width || m_height <= 1) && (m_slice_stride == m_row_stride * m_height || m_depth <= 1);
+	}
+
+	T &operator () (size_t x, size_t y, size_t z) const
+	{
+		assert(x < m_width && y < m_height && z < m_depth && "Grid coordinates out of range");
+		return m_data[z * m_slice_stride + y * m_row_stride + x];
+	}
+
+	T *row(size_t y, size_t z) const
+	{
+		assert(y < m_height && z < m_depth && "Grid row out of range");
+		return m_data + z * m_slice_stride + y * m_row_stride;
+	}
+
+	// the cells (x, y, 0) to (x, y, depth() - 1)
+	column_iterator depth_begin(size_t x, size_t y) const
+	{
+		assert(x < m_width && y < m_height && "Grid column out of range");
+		return column_iterator(m_data + y * m_row_stride + x, (ptrdiff_t)m_slice_stride);
+	}
+
+	column_iterator depth_end(size_t x, size_t y) const
+	{
+		return depth_begin(x, y) + (ptrdiff_t)m_depth;
+	}
+
+	// 2D view of the cells with the given z
+	CScriptArraySTLGrid2D<T> slice(size_t z) const
+	{
+		assert(z < m_depth && "Grid slice out of range");
+		return CScriptArraySTLGrid2D<T>(m_data + z * m_slice_stride, m_width, m_height, m_row_stride);
+	}
+
+	// view of the w * h * d cells starting at (x, y, z). It shares its elements with this view.
+	CScriptArraySTLGrid3D sub(size_t x, size_t y, size_t z, size_t w, size_t h, size_t d) const
+	{
+		assert(x + w <= m_width && y + h <= m_height && z + d <= m_depth && "Sub-grid out of range");
+		return CScriptArraySTLGrid3D(m_data + z * m_slice_stride + y * m_row_stride + x, w, h, d, m_row_stride, m_slice_stride);
+	}
+
+	// calls f(T *row, size_t y, size_t z) for every row
+	template <class F>
+	void for_each_row(F f) const
+	{
+		for(size_t z = 0; z < m_depth; ++z)
+		{
+			T *p = m_data + z * m_slice_stride;
+			for(size_t y = 0; y < m_height; ++y, p += m_row_stride) f(p, y, z);
+		}
+	}
+
+	// calls f(T &) for every cell, x fastest and z slowest
+	template <class F>
+	void for_each(F f) const
+	{
+		if(empty()) return;
+
+		if(is_contiguous())
+		{
+			for(T *p = m_data, *end = m_data + size(); p != end; ++p) f(*p);
+			return;
+		}
+
+		for_each_row([this, &f](T *row, size_t, size_t)
+		{
+			for(T *p = row, *end = row + m_width; p != end; ++p) f(*p);
+		});
+	}
+
+	// calls f(CScriptArraySTLGrid3D tile, size_t x, size_t y, size_t z) for tiles of at most
+	// tile_width * tile_height * tile_depth cells
+	template <class F>
+	void for_each_tile(size_t tile_width, size_t tile_height, size_t tile_depth, F f) const
+	{
+		assert(tile_width > 0 && tile_height > 0 && tile_depth > 0 && "Tiles can't be empty");
+
+		for(size_t z = 0; z < m_depth; z += tile_depth)
+		{
+			size_t d = std::min(tile_depth, m_depth - z);
+			for(size_t y = 0; y < m_height; y += tile_height)
+			{
+				size_t h = std::min(tile_height, m_height - y);
+				for(size_t x = 0; x < m_width; x += tile_width)
+				{
+					f(sub(x, y, z, std::min(tile_width, m_width - x), h, d), x, y, z);
+				}
+			}
+		}
+	}
+
+	// for_each_tile() with tiles that have about as many cells as the 2D tiles. Since the tiles
+	// are cubes, each one reads a few full rows from several slices.
+	template <class F>
+	void for_each_tile(F f) const
+	{
+		size_t elements = SCRIPTARRAYSTL_GRID_TILE_BYTES / sizeof(value_type);
+		size_t side = 1;
+		while(side * side * side * 8 <= elements) side *= 2;
+		for_each_tile(side, side, side, f);
+	}
+
+	void fill(const value_type &value) const
+	{
+		for_each_row([this, &value](T *row, size_t, size_t) { std::fill(row, row + m_width, value); });
+	}
+
+	template <class U>
+	void copy_from(const CScriptArraySTLGrid3D<U> &src) const
+	{
+		assert(src.width() == m_width && src.height() == m_height && src.depth() == m_depth && "Grid sizes don't match");
+		for_each_row([&src, this](T *row, size_t y, size_t z) { std::copy(src.row(y, z), src.row(y, z) + m_width, row); });
+	}
+
+private:
+	T     *m_data;
+	size_t m_width;
+	size_t m_height;
+	size_t m_depth;
+	size_t m_row_stride;
+	size_t m_slice_stride;
+};
+
+struct CScriptArraySTL_grid_binding
+{
+	static void SetException(const char *message)
+	{
+		asIScriptContext *ctx = asGetActiveContext();
+		if(ctx) ctx->SetException(message);
+	}
+
+	// Checks that (x, y, z) is inside a width * height grid that fits in the array and returns its
+	// index. The arguments are 32-bit values, so width * height fits in 64 bits, but multiplying
+	// that by z could wrap around into the array. z is checked against the number of whole slices
+	// in the array first, which keeps the rest of the computation below the array's size.
+	static bool Index(CScriptArray *self, asQWORD x, asQWORD y, asQWORD z, asQWORD width, asQWORD height, asUINT &index)
+	{
+		if(x >= width || y >= height)
+		{
+			SetException("Grid coordinates out of range");
+			return false;
+		}
+
+		asQWORD slice = width * height;
+		asQWORD size = self->GetSize();
+		if(z > 0 && z >= size / slice)
+		{
+			SetException("Index out of bounds");
+			return false;
+		}
+
+		asQWORD i = z * slice + y * width + x;
+		if(i >= size)
+		{
+			SetException("Index out of bounds");
+			return false;
+		}
+
+		index = (asUINT)i;
+		return true;
+	}
+
+	// T &cell(uint x, uint y, uint width)
+	static void Cell2D(asIScriptGeneric *gen)
+	{
+		CScriptArray *self = (CScriptArray *)gen->GetObject();
+		asUINT index;
+		if(!Index(self, gen->GetArgDWord(0), gen->GetArgDWord(1), 0, gen->GetArgDWord(2), ~(asDWORD)0, index)) return;
+		gen->SetReturnAddress(self->At(index));
+	}
+
+	// T &cell(uint x, uint y, uint z, uint width, uint height)
+	static void Cell3D(asIScriptGeneric *gen)
+	{
+		CScriptArray *self = (CScriptArray *)gen->GetObject();
+		asUINT index;
+		if(!Index(self, gen->GetArgDWord(0), gen->GetArgDWord(1), gen->GetArgDWord(2), gen->GetArgDWord(3), gen->GetArgDWord(4), index)) return;
+		gen->SetReturnAddress(self->At(index));
+	}
+
+	// void fillRect(uint x, uint y, uint w, uint h, uint width, const T &in value)
+	static void FillRect(asIScriptGeneric *gen)
+	{
+		CScriptArray *self = (CScriptArray *)gen->GetObject();
+		asQWORD x = gen->GetArgDWord(0);
+		asQWORD y = gen->GetArgDWord(1);
+		asQWORD w = gen->GetArgDWord(2);
+		asQWORD h = gen->GetArgDWord(3);
+		asQWORD width = gen->GetArgDWord(4);
+		void *value = gen->GetArgAddress(5);
+
+		if(w == 0 || h == 0) return;
+
+		asUINT first, last;
+		if(!Index(self, x, y, 0, width, ~(asDWORD)0, first)) return;
+		if(!Index(self, x + w - 1, y + h - 1, 0, width, ~(asDWORD)0, last)) return;
+
+		int typeId = self->GetElementTypeId();
+		if(typeId & asTYPEID_MASK_OBJECT)
+		{
+			// SetValue takes care of handles and of the type's assignment
+			for(asQWORD row = first; row <= last; row += width)
+			{
+				for(asQWORD i = row; i < row + w; ++i) self->SetValue((asUINT)i, value);
+			}
+			return;
+		}
+
+		// primitives are copied straight into the buffer a row at a time
+		int size = gen->GetEngine()->GetSizeOfPrimitiveType(typeId);
+		char *data = (char *)self->GetBuffer();
+		for(asQWORD row = first; row <= last; row += width)
+		{
+			char *p = data + (size_t)row * size;
+			for(asQWORD i = 0; i < w; ++i, p += size) memcpy(p, value, size);
+		}
+	}
+};
+
+// Registers the grid accessors as methods of array<T>. RegisterScriptArray() must be called first.
+inline int RegisterScriptArraySTLGrid(asIScriptEngine *engine)
+{
+	typedef CScriptArraySTL_grid_binding B;
+	int r;
+
+	r = engine->RegisterObjectMethod("array<T>", "T &cell(uint x, uint y, uint width)", asFUNCTION(B::Cell2D), asCALL_GENERIC); if(r < 0) return r;
+	r = engine->RegisterObjectMethod("array<T>", "const T &cell(uint x, uint y, uint width) const", asFUNCTION(B::Cell2D), asCALL_GENERIC); if(r < 0) return r;
+	r = engine->RegisterObjectMethod("array<T>", "T &cell(uint x, uint y, uint z, uint width, uint height)", asFUNCTION(B::Cell3D), asCALL_GENERIC); if(r < 0) return r;
+	r = engine->RegisterObjectMethod("array<T>", "const T &cell(uint x, uint y, uint z, uint width, uint height) const", asFUNCTION(B::Cell3D), asCALL_GENERIC); if(r < 0) return r;
+	r = engine->RegisterObjectMethod("array<T>", "void fillRect(uint x, uint y, uint w, uint h, uint width, const T &in value)", asFUNCTION(B::FillRect), asCALL_GENERIC); if(r < 0) return r;
+
+	return 0;
+}
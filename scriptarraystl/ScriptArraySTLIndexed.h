@@ -0,0 +1,396 @@
+// Script arrays with a hash index for finding elements.
+// CScriptArray::Find() compares every element with the engine's generic comparison, so looking
+// up a key in a long list costs a full scan. CScriptArrayIndexed can be used as the TArrayClass of
+// CScriptArraySTL and keeps a hash table that maps element values to their positions. The table
+// only holds positions and a hash per position, the values themselves are read from the array.
+// Elements with the same value are kept in a list in order, so IndexOf() returns the first
+// position of a value just like Find().
+// It is built on CScriptArrayTracked. Each lookup first re-hashes the changes made through
+// CScriptArraySTL and through the array's own C++ methods, and the elements added or removed at
+// the end of the array, without scanning the array. Other changes made by scripts (writes to
+// elements, inserting or removing in the middle) are not seen by lookups. After running scripts
+// that may have made them, the host calls Update(). With EnableWriteDetection() that compares a
+// checksum per block of the array and re-hashes the blocks that changed, otherwise it rebuilds
+// the index. Until then lookups can miss values that scripts moved or wrote, though a position they
+// return always holds the value.
+// The index uses the change tracking of the array, so consume_dirty_ranges() of an indexed array
+// always reports the whole array.
+// Arrays of the primitive types and of string can be indexed. float and double are compared by
+// value like Find() does, so 0 and -0 are equal and NaN is never found.
+//
+// RegisterScriptArraySTLIndexed() adds these methods to array<T>:
+//     int indexOf(const T &in value) const
+//     bool contains(const T &in value) const
+// For arrays created from C++ as CScriptArrayIndexed they use the index. Other arrays fall back
+// to find(). The methods tell the two apart with dynamic_cast, so this header needs RTTI and
+// fails to compile where the compiler reports it as disabled.
+//
+// Example:
+//     CScriptArraySTL<std::string, CScriptArrayIndexed> names;
+//     names.InitArray(engine);
+//     ... fill it and pass it to scripts ...
+//     names.GetRef()->Update();
+//     std::string key("player");
+//     int i = names.GetRef()->IndexOf(&key);
+// Copyright (c) 2014, Dominque A Douglas
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+//    in the documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+// OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#if (defined(__GNUC__) && !defined(__GXX_RTTI)) || (defined(_MSC_VER) && !defined(_CPPRTTI))
+#error "ScriptArraySTLIndexed.h needs RTTI for the indexOf() and contains() script methods."
+#endif
+
+#include <string.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "ScriptArraySTLTracked.h"
+
+class CScriptArrayIndexed : public CScriptArrayTracked
+{
+public:
+	CScriptArrayIndexed(asUINT length, asIObjectType *ot)
+		:CScriptArrayTracked(length, ot), m_mask(0), m_used(0), m_removed(0)
+	{
+		if(!(subTypeId & asTYPEID_MASK_OBJECT))
+		{
+			m_kind = (subTypeId == asTYPEID_FLOAT) ? KIND_FLOAT : (subTypeId == asTYPEID_DOUBLE) ? KIND_DOUBLE : KIND_BYTES;
+		}
+		else
+		{
+			assert(ot == CScriptArraySTLTypeCache::GetArrayType<std::string>(ot->GetEngine()) &&
+				"Only arrays of primitives and strings can be indexed.");
+			m_kind = KIND_STRING;
+		}
+	}
+
+	// returns the first position of value or -1 if it isn't in the array. value points to a value
+	// of the element type, as for Find().
+	int IndexOf(const void *value)
+	{
+		if(HasDirtyRanges() || GetSize() != m_positions.size()) Apply(ConsumeRecordedRanges());
+		if(m_slots.empty()) return -1;
+
+		asUINT hash = Hash(value);
+		for(asUINT s = hash & m_mask; ; s = (s + 1) & m_mask)
+		{
+			const SSlot &slot = m_slots[s];
+			if(slot.state == SLOT_EMPTY) return -1;
+			if(slot.state == SLOT_USED && slot.hash == hash && Equal(Element(slot.head), value)) return (int)slot.head;
+		}
+	}
+
+	bool Contains(const void *value)
+	{
+		return IndexOf(value) >= 0;
+	}
+
+	// Brings the index up to date with changes made by scripts. Call it after running scripts
+	// that may have written to the array. Without write detection this is a Rebuild().
+	void Update()
+	{
+		if(!IsWriteDetectionEnabled())
+		{
+			Rebuild();
+			return;
+		}
+
+		Apply(ConsumeDirtyRanges());
+	}
+
+	// Replaces the whole index, for after bulk changes that would touch most of it anyway
+	void Rebuild()
+	{
+		ConsumeDirtyRanges();
+
+		size_t size = GetSize();
+		m_positions.assign(size, SPosition());
+		Rehash(0);
+		for(size_t p = 0; p < size; ++p) Insert((asUINT)p);
+	}
+
+private:
+	enum { NONE = 0xFFFFFFFF };
+	enum { KIND_BYTES, KIND_FLOAT, KIND_DOUBLE, KIND_STRING };
+	enum { SLOT_EMPTY, SLOT_USED, SLOT_REMOVED };
+
+	// a distinct value in the table and its positions
+	struct SSlot
+	{
+		asUINT head;  // first position with the value
+		asUINT tail;  // last position with the value
+		asUINT hash;
+		asUINT state;
+	};
+
+	// links the positions that have the same value, in order
+	struct SPosition
+	{
+		asUINT slot; // NONE while the position isn't in the index
+		asUINT prev;
+		asUINT next;
+
+		SPosition() : slot(NONE), prev(NONE), next(NONE) {}
+	};
+
+	int                    m_kind;
+	std::vector<SSlot>     m_slots;
+	asUINT                 m_mask;
+	size_t                 m_used;    // slots holding a value
+	size_t                 m_removed; // slots whose value is gone, which still lengthen searches
+	std::vector<SPosition> m_positions;
+
+	CScriptArrayIndexed(const CScriptArrayIndexed &);
+	CScriptArrayIndexed &operator = (const CScriptArrayIndexed &);
+
+	const void *Element(asUINT p) const
+	{
+		return CScriptArray::At(p);
+	}
+
+	asUINT Hash(const void *value) const
+	{
+		asQWORD bits = 0;
+		switch(m_kind)
+		{
+		case KIND_STRING:
+			return (asUINT)std::hash<std::string>()(*(const std::string *)value);
+		case KIND_FLOAT:
+			{
+				float f = *(const float *)value;
+				if(f == 0.0f) f = 0.0f; // -0 is equal to 0
+				memcpy(&bits, &f, sizeof(f));
+				break;
+			}
+		case KIND_DOUBLE:
+			{
+				double d = *(const double *)value;
+				if(d == 0.0) d = 0.0;
+				memcpy(&bits, &d, sizeof(d));
+				break;
+			}
+		default:
+			memcpy(&bits, value, elementSize);
+			break;
+		}
+
+		// the finalizer of MurmurHash3, so keys that differ in their high bits spread out
+		bits ^= bits >> 33;
+		bits *= 0xff51afd7ed558ccdULL;
+		bits ^= bits >> 33;
+		bits *= 0xc4ceb3f95a8ae53bULL;
+		bits ^= bits >> 33;
+		return (asUINT)bits;
+	}
+
+	bool Equal(const void *a, const void *b) const
+	{
+		switch(m_kind)
+		{
+		case KIND_STRING: return *(const std::string *)a == *(const std::string *)b;
+		case KIND_FLOAT:  return *(const float *)a == *(const float *)b;
+		case KIND_DOUBLE: return *(const double *)a == *(const double *)b;
+		default:          return memcmp(a, b, elementSize) == 0;
+		}
+	}
+
+	// re-hashes the changed ranges and the elements added or removed at the end
+	void Apply(const std::vector<SScriptArraySTLRange> &ranges)
+	{
+		size_t size = GetSize();
+
+		// elements that were removed from the end
+		for(size_t p = m_positions.size(); p > size; --p) Remove((asUINT)(p - 1));
+
+		// Changed elements are all taken out before any is put back, so the values of the
+		// positions still in the index are current when new values are compared to them.
+		size_t indexed = std::min(size, m_positions.size());
+		for(size_t r = 0; r < ranges.size(); ++r)
+		{
+			for(size_t p = ranges[r].first; p < ranges[r].last && p < indexed; ++p) Remove((asUINT)p);
+		}
+
+		m_positions.resize(size);
+		for(size_t r = 0; r < ranges.size(); ++r)
+		{
+			for(size_t p = ranges[r].first; p < ranges[r].last && p < indexed; ++p) Insert((asUINT)p);
+		}
+
+		// elements added at the end, whether or not they were recorded as changed
+		for(size_t p = indexed; p < size; ++p) Insert((asUINT)p);
+	}
+
+	// adds position p, whose current value is used
+	void Insert(asUINT p)
+	{
+		// the table is kept at most half full, counting removed slots
+		if((m_used + m_removed + 1) * 2 > m_slots.size())
+		{
+			Rehash(m_used + 1);
+		}
+
+		const void *value = Element(p);
+		asUINT hash = Hash(value);
+		asUINT free_slot = NONE;
+		asUINT s = hash & m_mask;
+		for(; ; s = (s + 1) & m_mask)
+		{
+			SSlot &slot = m_slots[s];
+			if(slot.state == SLOT_EMPTY) break;
+			if(slot.state == SLOT_REMOVED)
+			{
+				if(free_slot == NONE) free_slot = s;
+				continue;
+			}
+			if(slot.hash == hash && Equal(Element(slot.head), value))
+			{
+				Link(s, p);
+				return;
+			}
+		}
+
+		// a new value
+		if(free_slot != NONE)
+		{
+			s = free_slot;
+			--m_removed;
+		}
+		SSlot &slot = m_slots[s];
+		slot.head = NONE;
+		slot.tail = NONE;
+		slot.hash = hash;
+		slot.state = SLOT_USED;
+		++m_used;
+		Link(s, p);
+	}
+
+	// adds p to the positions of slot s, keeping them in order
+	void Link(asUINT s, asUINT p)
+	{
+		SSlot &slot = m_slots[s];
+		SPosition &pos = m_positions[p];
+
+		// positions are usually added in increasing order, so start from the end
+		asUINT after = slot.tail;
+		while(after != NONE && after > p) after = m_positions[after].prev;
+
+		pos.slot = s;
+		pos.prev = after;
+		pos.next = (after == NONE) ? slot.head : m_positions[after].next;
+
+		if(after == NONE) slot.head = p;
+		else m_positions[after].next = p;
+
+		if(pos.next == NONE) slot.tail = p;
+		else m_positions[pos.next].prev = p;
+	}
+
+	// takes position p out of the index. Its old value isn't needed.
+	void Remove(asUINT p)
+	{
+		SPosition &pos = m_positions[p];
+		if(pos.slot == NONE) return;
+
+		SSlot &slot = m_slots[pos.slot];
+		if(pos.prev != NONE) m_positions[pos.prev].next = pos.next;
+		else slot.head = pos.next;
+		if(pos.next != NONE) m_positions[pos.next].prev = pos.prev;
+		else slot.tail = pos.prev;
+
+		if(slot.head == NONE)
+		{
+			slot.state = SLOT_REMOVED;
+			--m_used;
+			++m_removed;
+		}
+		pos = SPosition();
+	}
+
+	// makes a table for at least count values and puts back every position in the index
+	void Rehash(size_t count)
+	{
+		size_t capacity = 16;
+		while(capacity < count * 2) capacity *= 2;
+
+		SSlot empty = { NONE, NONE, 0, SLOT_EMPTY };
+		m_slots.assign(capacity, empty);
+		m_mask = (asUINT)(capacity - 1);
+		m_used = 0;
+		m_removed = 0;
+
+		// every position that was in the index goes back in, in order
+		std::vector<asUINT> positions;
+		for(size_t p = 0; p < m_positions.size(); ++p)
+		{
+			if(m_positions[p].slot != NONE) positions.push_back((asUINT)p);
+			m_positions[p] = SPosition();
+		}
+		for(size_t i = 0; i < positions.size(); ++i) Insert(positions[i]);
+	}
+};
+
+// Changes made through CScriptArraySTL go to the index
+template <>
+struct CScriptArraySTL_tracker<CScriptArrayIndexed>
+{
+	static void MarkDirty(CScriptArrayIndexed *as_array, size_t first, size_t last)
+	{
+		as_array->MarkDirty(first, last);
+	}
+
+	static std::vector<SScriptArraySTLRange> ConsumeDirtyRanges(CScriptArrayIndexed *as_array)
+	{
+		return CScriptArraySTL_tracker<CScriptArray>::ConsumeDirtyRanges(as_array);
+	}
+};
+
+struct CScriptArraySTL_indexed_binding
+{
+	static int IndexOf(asIScriptGeneric *gen)
+	{
+		CScriptArray *self = (CScriptArray *)gen->GetObject();
+		void *value = gen->GetArgAddress(0);
+
+		// arrays created by scripts are plain CScriptArrays
+		CScriptArrayIndexed *indexed = dynamic_cast<CScriptArrayIndexed *>(self);
+		if(indexed) return indexed->IndexOf(value);
+		return self->Find(0, value);
+	}
+
+	static void ScriptIndexOf(asIScriptGeneric *gen)
+	{
+		gen->SetReturnDWord((asDWORD)IndexOf(gen));
+	}
+
+	static void ScriptContains(asIScriptGeneric *gen)
+	{
+		gen->SetReturnByte(IndexOf(gen) >= 0 ? 1 : 0);
+	}
+};
+
+// Registers indexOf() and contains() as methods of array<T>. RegisterScriptArray() must be called first.
+inline int RegisterScriptArraySTLIndexed(asIScriptEngine *engine)
+{
+	typedef CScriptArraySTL_indexed_binding B;
+	int r;
+
+	r = engine->RegisterObjectMethod("array<T>", "int indexOf(const T &in value) const", asFUNCTION(B::ScriptIndexOf), asCALL_GENERIC); if(r < 0) return r;
+	r = engine->RegisterObjectMethod("array<T>", "bool contains(const T &in value) const", asFUNCTION(B::ScriptContains), asCALL_GENERIC); if(r < 0) return r;
+
+	return 0;
+}
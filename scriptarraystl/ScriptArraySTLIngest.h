@@ -0,0 +1,251 @@
+// Streaming C++ data into a script array from other threads.
+// CScriptArraySTLIngest is a bounded lock-free queue. Producer threads push elements with
+// try_push() or push() and the thread that owns the script engine moves everything that has
+// arrived into a CScriptArraySTL with drain(), resizing the array once per batch. Producers never
+// touch the script array or the engine, so they don't contend with scripts reading it.
+// With multi_producer set to false the queue is single producer, which makes pushing a little
+// cheaper. Only one thread may call drain().
+// The queue has a fixed capacity. try_push() fails when the queue is full and push() waits for
+// drain() to make room, so producers are held back when the engine thread falls behind.
+//
+// Example:
+//     CScriptArraySTLIngest<float> samples(4096, 1024);
+//     ... on a network thread ...
+//     samples.push(value);
+//     ... on the engine thread, before calling the script ...
+//     samples.drain(batch);
+// Copyright (c) 2014, Dominque A Douglas
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+//    in the documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+// OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include "ScriptArraySTL.h"
+
+// Queue statistics
+struct SScriptArraySTLIngestStats
+{
+	size_t pushed;     // elements pushed since the queue was created
+	size_t rejected;   // calls to try_push() that failed because the queue was full
+	size_t drained;    // elements moved into arrays by drain()
+	size_t drains;     // calls to drain() that moved at least one element
+	size_t high_water; // the most elements drain() has found waiting
+};
+
+template <class T, bool multi_producer = true>
+class CScriptArraySTLIngest
+{
+public:
+	// capacity is rounded up to a power of two. batch_size is the most elements drain() moves by
+	// default.
+	explicit CScriptArraySTLIngest(size_t capacity = 4096, size_t batch_size = 1024)
+		:m_batch_size(batch_size), m_tail(0), m_rejected(0), m_head(0), m_drains(0), m_high_water(0)
+	{
+		size_t n = 2;
+		while(n < capacity) n *= 2;
+		m_mask = n - 1;
+
+		m_slots.reset(new SSlot[n]);
+		for(size_t i = 0; i < n; ++i)
+		{
+			m_slots[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	// Adds an element. Returns false if the queue is full. Can be called from any producer thread.
+	bool try_push(const T &value)
+	{
+		size_t pos;
+		if(!claim(1, pos))
+		{
+			m_rejected.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+
+		SSlot &slot = m_slots[pos & m_mask];
+		slot.value = value;
+		slot.sequence.store(pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Adds count elements, either all of them or, if there isn't room, none. Returns false if the
+	// queue doesn't have room for all of them.
+	bool try_push(const T *values, size_t count)
+	{
+		if(count == 0) return true;
+
+		size_t pos;
+		if(count > capacity() || !claim(count, pos))
+		{
+			m_rejected.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+
+		for(size_t i = 0; i < count; ++i)
+		{
+			SSlot &slot = m_slots[(pos + i) & m_mask];
+			slot.value = values[i];
+			slot.sequence.store(pos + i + 1, std::memory_order_release);
+		}
+		return true;
+	}
+
+	// Adds an element, waiting for drain() to make room if the queue is full
+	void push(const T &value)
+	{
+		size_t pos;
+		while(!claim(1, pos))
+		{
+			std::this_thread::yield();
+		}
+
+		SSlot &slot = m_slots[pos & m_mask];
+		slot.value = value;
+		slot.sequence.store(pos + 1, std::memory_order_release);
+	}
+
+	// Moves up to max_count elements that have arrived into the end of out, resizing it once.
+	// Returns the number of elements moved. Must only be called from one thread at a time, which
+	// is normally the thread that owns the engine.
+	template <class A>
+	size_t drain(CScriptArraySTL<T, A> &out, size_t max_count)
+	{
+		// count the elements that are ready. A producer that has claimed a slot but hasn't
+		// finished writing it stops the batch there.
+		size_t head = m_head.load(std::memory_order_relaxed);
+		size_t n = 0;
+		while(n < max_count && m_slots[(head + n) & m_mask].sequence.load(std::memory_order_acquire) == head + n + 1)
+		{
+			++n;
+		}
+		if(n == 0) return 0;
+
+		size_t waiting = m_tail.load(std::memory_order_relaxed) - head;
+		if(waiting > m_high_water) m_high_water = waiting;
+
+		size_t first = out.size();
+		out.resize(first + n);
+		for(size_t i = 0; i < n; ++i)
+		{
+			SSlot &slot = m_slots[(head + i) & m_mask];
+			out[first + i] = std::move(slot.value);
+			slot.sequence.store(head + i + capacity(), std::memory_order_release);
+		}
+		m_head.store(head + n, std::memory_order_release);
+		m_drains++;
+
+		return n;
+	}
+
+	// moves up to the batch size
+	template <class A>
+	size_t drain(CScriptArraySTL<T, A> &out)
+	{
+		return drain(out, m_batch_size);
+	}
+
+	// the number of elements waiting. This is only a snapshot when other threads are pushing.
+	size_t size() const
+	{
+		return m_tail.load(std::memory_order_relaxed) - m_head.load(std::memory_order_relaxed);
+	}
+
+	size_t capacity() const
+	{
+		return m_mask + 1;
+	}
+
+	size_t GetBatchSize() const
+	{
+		return m_batch_size;
+	}
+
+	// only call this from the thread that calls drain()
+	void SetBatchSize(size_t batch_size)
+	{
+		m_batch_size = batch_size;
+	}
+
+	// only call this from the thread that calls drain()
+	SScriptArraySTLIngestStats GetStats() const
+	{
+		SScriptArraySTLIngestStats stats;
+		stats.pushed = m_tail.load(std::memory_order_relaxed);
+		stats.rejected = m_rejected.load(std::memory_order_relaxed);
+		stats.drained = m_head.load(std::memory_order_relaxed);
+		stats.drains = m_drains;
+		stats.high_water = m_high_water;
+		return stats;
+	}
+
+private:
+	// Each slot's sequence is the queue position that can be written to it next, or that
+	// position + 1 once the value has been written. Draining moves it on by the capacity.
+	struct SSlot
+	{
+		std::atomic<size_t> sequence;
+		T                   value;
+	};
+
+	// padding keeps the producer and consumer positions on separate cache lines
+	typedef char padding[64];
+
+	std::unique_ptr<SSlot[]> m_slots;
+	size_t                   m_mask;
+	size_t                   m_batch_size;
+	padding                  m_pad0;
+	std::atomic<size_t>      m_tail;     // next position producers write to
+	std::atomic<size_t>      m_rejected;
+	padding                  m_pad1;
+	std::atomic<size_t>      m_head;     // next position drain() reads from
+	size_t                   m_drains;
+	size_t                   m_high_water;
+
+	// Claims count positions starting at pos. Fails if the queue is full. The slots are freed in
+	// order, so if the last one is free the others are too.
+	bool claim(size_t count, size_t &pos)
+	{
+		pos = m_tail.load(std::memory_order_relaxed);
+		for(;;)
+		{
+			size_t sequence = m_slots[(pos + count - 1) & m_mask].sequence.load(std::memory_order_acquire);
+			intptr_t difference = (intptr_t)sequence - (intptr_t)(pos + count - 1);
+			if(difference < 0) return false;
+
+			if(difference == 0)
+			{
+				if(!multi_producer)
+				{
+					m_tail.store(pos + count, std::memory_order_relaxed);
+					return true;
+				}
+				if(m_tail.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed)) return true;
+			}
+			else
+			{
+				// another producer claimed the position first
+				pos = m_tail.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	CScriptArraySTLIngest(const CScriptArraySTLIngest &);
+	CScriptArraySTLIngest &operator = (const CScriptArraySTLIngest &);
+};
@@ -0,0 +1,332 @@
+// Calling a script function for every element of an array.
+// Calling a script function from C++ takes a Prepare(), setting the arguments and an Execute().
+// CScriptArraySTLInvoker does this for a whole array or a range of it with as little as the
+// engine allows per element. The function is checked once, the context is prepared again with
+// the same function (which the engine makes cheap), the element's address is written straight
+// into the argument instead of going through SetArgAddress(), and the contexts are kept for
+// the next call instead of being created each time.
+// The script function takes the element by reference, so nothing is copied, and may take the
+// element's index as a second uint argument:
+//     void update(particle &inout p)
+//     float weight(const item &in it, uint index)
+// ForEach() calls it for each element and ignores what it returns. Transform() stores what it
+// returns for element i in out[i - first]. out is resized on the calling thread first, and the
+// function's return type must be out's element type, returned by value. Transform() only reads
+// its source array, so the function must take the element as const &in.
+// ParallelForEach() and ParallelTransform() split the range into chunks on a
+// CScriptArraySTLThreadPool, and each thread runs its chunks with a context of its own. This is
+// only safe when the engine was built with thread support, asPrepareMultithread() has been
+// called, and the script function can run on several threads at once, which means it must not
+// change global variables or objects that other elements can reach. Pool threads should call
+// asThreadCleanup() before they exit.
+// The calls return 0 when every element was done, -1 if a context couldn't be created or
+// prepared, -2 if the function's parameters don't fit the array, or else the asEXECUTION_*
+// result of the element that failed (ie asEXECUTION_EXCEPTION). When several elements fail the
+// one with the lowest index is reported. Every element before it is done, and the elements after
+// it may or may not be. GetFailedIndex() and GetExceptionString() tell what went wrong.
+//
+// Example:
+//     CScriptArraySTLInvoker invoker(module->GetFunctionByDecl("float weight(const item &in, uint)"));
+//     CScriptArraySTL<float> weights;
+//     weights.InitArray(engine);
+//     if(invoker.Transform(items, weights) == asEXECUTION_EXCEPTION)
+//         printf("item %u: %s\n", (unsigned)invoker.GetFailedIndex(), invoker.GetExceptionString().c_str());
+// Copyright (c) 2014, Dominque A Douglas
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+//    in the documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+// OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ScriptArraySTLParallel.h"
+
+// elements in each chunk handed to a pool thread by the parallel calls. A script call costs far
+// more than touching its element, so chunks are counted in calls rather than bytes.
+#ifndef SCRIPTARRAYSTL_INVOKE_CHUNK
+#define SCRIPTARRAYSTL_INVOKE_CHUNK 256
+#endif
+
+class CScriptArraySTLInvoker
+{
+public:
+	explicit CScriptArraySTLInvoker(asIScriptFunction *func)
+		:m_func(func), m_pass_index(false), m_failed_index((size_t)-1), m_result(0)
+	{
+		m_func->AddRef();
+	}
+
+	~CScriptArraySTLInvoker()
+	{
+		for(size_t i = 0; i < m_contexts.size(); ++i) m_contexts[i]->Release();
+		m_func->Release();
+	}
+
+	// calls the function for every element of a
+	template <class T, class A>
+	int ForEach(CScriptArraySTL<T, A> &a)
+	{
+		return ForEach(a, 0, a.size());
+	}
+
+	// calls the function for the elements [first, last) of a
+	template <class T, class A>
+	int ForEach(CScriptArraySTL<T, A> &a, size_t first, size_t last)
+	{
+		CScriptArraySTL_span<T> in(a);
+		int r = Begin<T, void>(in.size(), first, last, false);
+		if(r != 0) return r;
+
+		NoResult store;
+		return Run(in, store, first, last);
+	}
+
+	// sets out[i] to the result of the function for element i of in
+	template <class T, class A, class R, class B>
+	int Transform(const CScriptArraySTL<T, A> &in, CScriptArraySTL<R, B> &out)
+	{
+		return Transform(in, out, 0, in.size());
+	}
+
+	// sets out[i - first] to the result of the function for element i of in, for the elements
+	// [first, last). out is resized to last - first.
+	template <class T, class A, class R, class B>
+	int Transform(const CScriptArraySTL<T, A> &in, CScriptArraySTL<R, B> &out, size_t first, size_t last)
+	{
+		CScriptArraySTL_span<T> src(in);
+		int r = Begin<T, R>(src.size(), first, last, true);
+		if(r != 0) return r;
+
+		if(out.size() != last - first) out.resize(last - first);
+		Result<R> store(out, first);
+		return Run(src, store, first, last);
+	}
+
+	// ForEach() with the elements spread over the threads of pool
+	template <class T, class A>
+	int ParallelForEach(CScriptArraySTL<T, A> &a, CScriptArraySTLThreadPool &pool = CScriptArraySTLThreadPool::Get())
+	{
+		CScriptArraySTL_span<T> in(a);
+		int r = Begin<T, void>(in.size(), 0, in.size(), false);
+		if(r != 0) return r;
+
+		NoResult store;
+		return RunParallel(in, store, in.size(), pool);
+	}
+
+	// Transform() with the elements spread over the threads of pool
+	template <class T, class A, class R, class B>
+	int ParallelTransform(const CScriptArraySTL<T, A> &in, CScriptArraySTL<R, B> &out, CScriptArraySTLThreadPool &pool = CScriptArraySTLThreadPool::Get())
+	{
+		CScriptArraySTL_span<T> src(in);
+		int r = Begin<T, R>(src.size(), 0, src.size(), true);
+		if(r != 0) return r;
+
+		if(out.size() != in.size()) out.resize(in.size());
+		Result<R> store(out, 0);
+		return RunParallel(src, store, src.size(), pool);
+	}
+
+	// index of the element whose call failed in the last call, or (size_t)-1
+	size_t GetFailedIndex() const
+	{
+		return m_failed_index.load();
+	}
+
+	// the script exception raised by the failed element, if that was why it failed
+	const std::string &GetExceptionString() const
+	{
+		return m_exception;
+	}
+
+	asIScriptFunction *GetFunction() const
+	{
+		return m_func;
+	}
+
+private:
+	asIScriptFunction               *m_func;
+	bool                             m_pass_index; // the function takes the index as its second argument
+	std::mutex                       m_mutex;        // guards the contexts and the failure
+	std::vector<asIScriptContext *>  m_contexts;     // every context made
+	std::vector<asIScriptContext *>  m_idle;         // the ones not in use
+	std::atomic<size_t>              m_failed_index; // lowest failed index so far, also read without the lock
+	int                              m_result;
+	std::string                      m_exception;
+
+	CScriptArraySTLInvoker(const CScriptArraySTLInvoker &);
+	CScriptArraySTLInvoker &operator = (const CScriptArraySTLInvoker &);
+
+	struct NoResult
+	{
+		void operator () (asIScriptContext *, size_t) const
+		{
+		}
+	};
+
+	// copies the return value of element i into its place in out
+	template <class R>
+	struct Result
+	{
+		static_assert(!std::is_pointer<R>::value, "Transform can't return handles");
+
+		CScriptArraySTL_span<R> out;
+		size_t first;
+
+		template <class B>
+		Result(CScriptArraySTL<R, B> &o, size_t f) : out(o), first(f) {}
+
+		// works for primitives, which are read from the return register, and for objects
+		void operator () (asIScriptContext *ctx, size_t i) const
+		{
+			out[i - first] = *(const R *)ctx->GetAddressOfReturnValue();
+		}
+	};
+
+	// Checks the function and the range and clears the last failure. read_only is set when the
+	// elements can't be changed, and then the function has to take them as const &in.
+	template <class T, class R>
+	int Begin(size_t size, size_t first, size_t last, bool read_only)
+	{
+		m_failed_index.store((size_t)-1);
+		m_result = 0;
+		m_exception.clear();
+
+		assert(first <= last && last <= size && "Range out of bounds");
+		(void)size;
+
+		asIScriptEngine *engine = m_func->GetEngine();
+		asIObjectType *t = CScriptArraySTLTypeCache::GetArrayType<T>(engine);
+		if(t == NULL) return -2;
+
+		asUINT params = m_func->GetParamCount();
+		asDWORD flags = 0;
+		if(params < 1 || params > 2) return -2;
+		if(m_func->GetParamTypeId(0, &flags) != t->GetSubTypeId() || (flags & asTM_INOUTREF) == 0) return -2;
+		if(read_only && ((flags & asTM_INOUTREF) != asTM_INREF || (flags & asTM_CONST) == 0)) return -2;
+
+		m_pass_index = params == 2;
+		if(m_pass_index && (m_func->GetParamTypeId(1, &flags) != asTYPEID_UINT32 || (flags & asTM_INOUTREF) != 0)) return -2;
+
+		return CheckReturn<R>(engine);
+	}
+
+	template <class R>
+	typename std::enable_if<std::is_void<R>::value, int>::type CheckReturn(asIScriptEngine *)
+	{
+		return 0;
+	}
+
+	template <class R>
+	typename std::enable_if<!std::is_void<R>::value, int>::type CheckReturn(asIScriptEngine *engine)
+	{
+		asIObjectType *t = CScriptArraySTLTypeCache::GetArrayType<R>(engine);
+		asDWORD flags = 0;
+		if(t == NULL || m_func->GetReturnTypeId(&flags) != t->GetSubTypeId() || (flags & asTM_INOUTREF) != 0) return -2;
+		return 0;
+	}
+
+	asIScriptContext *AcquireContext()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if(!m_idle.empty())
+		{
+			asIScriptContext *ctx = m_idle.back();
+			m_idle.pop_back();
+			return ctx;
+		}
+
+		asIScriptContext *ctx = m_func->GetEngine()->CreateContext();
+		if(ctx) m_contexts.push_back(ctx);
+		return ctx;
+	}
+
+	void ReleaseContext(asIScriptContext *ctx)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_idle.push_back(ctx);
+	}
+
+	// records a failure at element index, keeping the one with the lowest index
+	void Fail(size_t index, int result, asIScriptContext *ctx)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if(m_failed_index.load() < index) return;
+
+		m_result = result;
+		m_exception = (ctx && result == asEXECUTION_EXCEPTION && ctx->GetExceptionString()) ? ctx->GetExceptionString() : "";
+		m_failed_index.store(index);
+	}
+
+	// calls the function for [begin, end) with one context
+	template <class T, class Store>
+	void RunRange(CScriptArraySTL_span<T> &in, const Store &store, size_t begin, size_t end)
+	{
+		asIScriptContext *ctx = AcquireContext();
+		if(ctx == NULL)
+		{
+			Fail(begin, -1, NULL);
+			return;
+		}
+
+		for(size_t i = begin; i < end; ++i)
+		{
+			// elements before a failure still have to be done, the ones after it don't
+			if(i > m_failed_index.load(std::memory_order_relaxed)) break;
+
+			if(ctx->Prepare(m_func) < 0)
+			{
+				Fail(i, -1, NULL);
+				break;
+			}
+
+			// the arguments were checked in Begin, so they are written directly
+			*(void **)ctx->GetAddressOfArg(0) = (void *)&in[i];
+			if(m_pass_index) *(asUINT *)ctx->GetAddressOfArg(1) = (asUINT)i;
+
+			int r = ctx->Execute();
+			if(r != asEXECUTION_FINISHED)
+			{
+				Fail(i, r, ctx);
+				break;
+			}
+			store(ctx, i);
+		}
+
+		// leave the context without references to the arguments or the result
+		ctx->Unprepare();
+		ReleaseContext(ctx);
+	}
+
+	template <class T, class Store>
+	int Run(CScriptArraySTL_span<T> &in, const Store &store, size_t first, size_t last)
+	{
+		if(first < last) RunRange(in, store, first, last);
+		return m_result;
+	}
+
+	template <class T, class Store>
+	int RunParallel(CScriptArraySTL_span<T> &in, const Store &store, size_t count, CScriptArraySTLThreadPool &pool)
+	{
+		pool.ParallelFor(count, SCRIPTARRAYSTL_INVOKE_CHUNK, [this, &in, &store](size_t begin, size_t end)
+		{
+			RunRange(in, store, begin, end);
+		});
+		return m_result;
+	}
+};
@@ -0,0 +1,518 @@
+// Native vector kernels for numeric script arrays.
+// Sum, min, max, dot, axpy, clamp and elementwise add/mul for arrays of float, double and int.
+// The instruction set is picked once at run time (AVX2, then SSE2, then plain C++), so the same
+// binary runs on any x86 host and on other platforms.
+// From C++ the kernels are used through CScriptArraySTLKernels, ie
+//     float total = CScriptArraySTLKernels::Sum(samples);
+// RegisterScriptArraySTLKernels() registers them as methods of array<T>, so scripts can call
+// samples.sum() and have it run natively. It must be called after RegisterScriptArray().
+// Vectorized sums add the elements in a different order than a simple loop, so float and double
+// results can differ from one in the last bits.
+// Copyright (c) 2014, Dominque A Douglas
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+//    in the documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+// OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <stddef.h>
+
+#include "ScriptArraySTL.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SCRIPTARRAYSTL_KERNELS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+// SSE2 is part of the base instruction set on x86-64, but has to be enabled on 32-bit x86
+#if defined(SCRIPTARRAYSTL_KERNELS_X86) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define SCRIPTARRAYSTL_KERNELS_SSE2 1
+#endif
+
+// Arithmetic for the elements the kernels handle one at a time. Integers wrap on overflow like
+// the SIMD lanes and AngelScript do, which signed arithmetic in C++ doesn't guarantee, so they
+// are added and multiplied as their unsigned type.
+template <class T, bool integer = std::is_integral<T>::value>
+struct CScriptArraySTL_arith
+{
+	static T add(T a, T b) { return a + b; }
+	static T mul(T a, T b) { return a * b; }
+};
+
+template <class T>
+struct CScriptArraySTL_arith<T, true>
+{
+	typedef typename std::make_unsigned<T>::type U;
+
+	static T add(T a, T b) { return (T)((U)a + (U)b); }
+	static T mul(T a, T b) { return (T)((U)a * (U)b); }
+};
+
+// plain C++ operations, one element at a time
+template <class T>
+struct CScriptArraySTL_scalar_ops
+{
+	typedef T value_type;
+	typedef T vec;
+	static const size_t width = 1;
+
+	static vec load(const T *p)           { return *p; }
+	static void store(T *p, vec v)        { *p = v; }
+	static vec set1(T v)                  { return v; }
+	static vec add(vec a, vec b)          { return CScriptArraySTL_arith<T>::add(a, b); }
+	static vec mul(vec a, vec b)          { return CScriptArraySTL_arith<T>::mul(a, b); }
+	static vec min(vec a, vec b)          { return b < a ? b : a; }
+	static vec max(vec a, vec b)          { return b > a ? b : a; }
+};
+
+#define SCRIPTARRAYSTL_KERNELS_NAME CScriptArraySTL_kernels_default
+#include "ScriptArraySTLKernels.inl"
+#undef SCRIPTARRAYSTL_KERNELS_NAME
+
+#ifdef SCRIPTARRAYSTL_KERNELS_SSE2
+template <class T>
+struct CScriptArraySTL_sse2_ops;
+
+template <>
+struct CScriptArraySTL_sse2_ops<float>
+{
+	typedef float value_type;
+	typedef __m128 vec;
+	static const size_t width = 4;
+
+	static vec load(const float *p)       { return _mm_loadu_ps(p); }
+	static void store(float *p, vec v)    { _mm_storeu_ps(p, v); }
+	static vec set1(float v)              { return _mm_set1_ps(v); }
+	static vec add(vec a, vec b)          { return _mm_add_ps(a, b); }
+	static vec mul(vec a, vec b)          { return _mm_mul_ps(a, b); }
+	static vec min(vec a, vec b)          { return _mm_min_ps(a, b); }
+	static vec max(vec a, vec b)          { return _mm_max_ps(a, b); }
+};
+
+template <>
+struct CScriptArraySTL_sse2_ops<double>
+{
+	typedef double value_type;
+	typedef __m128d vec;
+	static const size_t width = 2;
+
+	static vec load(const double *p)      { return _mm_loadu_pd(p); }
+	static void store(double *p, vec v)   { _mm_storeu_pd(p, v); }
+	static vec set1(double v)             { return _mm_set1_pd(v); }
+	static vec add(vec a, vec b)          { return _mm_add_pd(a, b); }
+	static vec mul(vec a, vec b)          { return _mm_mul_pd(a, b); }
+	static vec min(vec a, vec b)          { return _mm_min_pd(a, b); }
+	static vec max(vec a, vec b)          { return _mm_max_pd(a, b); }
+};
+
+template <>
+struct CScriptArraySTL_sse2_ops<int>
+{
+	typedef int value_type;
+	typedef __m128i vec;
+	static const size_t width = 4;
+
+	static vec load(const int *p)         { return _mm_loadu_si128((const __m128i *)p); }
+	static void store(int *p, vec v)      { _mm_storeu_si128((__m128i *)p, v); }
+	static vec set1(int v)                { return _mm_set1_epi32(v); }
+	static vec add(vec a, vec b)          { return _mm_add_epi32(a, b); }
+
+	// SSE2 has no 32-bit multiply or min/max, so build them from what it does have
+	static vec mul(vec a, vec b)
+	{
+		__m128i even = _mm_mul_epu32(a, b);
+		__m128i odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+		return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+	}
+	static vec min(vec a, vec b)
+	{
+		__m128i lt = _mm_cmplt_epi32(a, b);
+		return _mm_or_si128(_mm_and_si128(lt, a), _mm_andnot_si128(lt, b));
+	}
+	static vec max(vec a, vec b)
+	{
+		__m128i gt = _mm_cmpgt_epi32(a, b);
+		return _mm_or_si128(_mm_and_si128(gt, a), _mm_andnot_si128(gt, b));
+	}
+};
+#endif
+
+#ifdef SCRIPTARRAYSTL_KERNELS_X86
+// everything in here is compiled for AVX2 and only called after checking the CPU supports it
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+template <class T>
+struct CScriptArraySTL_avx2_ops;
+
+template <>
+struct CScriptArraySTL_avx2_ops<float>
+{
+	typedef float value_type;
+	typedef __m256 vec;
+	static const size_t width = 8;
+
+	static vec load(const float *p)       { return _mm256_loadu_ps(p); }
+	static void store(float *p, vec v)    { _mm256_storeu_ps(p, v); }
+	static vec set1(float v)              { return _mm256_set1_ps(v); }
+	static vec add(vec a, vec b)          { return _mm256_add_ps(a, b); }
+	static vec mul(vec a, vec b)          { return _mm256_mul_ps(a, b); }
+	static vec min(vec a, vec b)          { return _mm256_min_ps(a, b); }
+	static vec max(vec a, vec b)          { return _mm256_max_ps(a, b); }
+};
+
+template <>
+struct CScriptArraySTL_avx2_ops<double>
+{
+	typedef double value_type;
+	typedef __m256d vec;
+	static const size_t width = 4;
+
+	static vec load(const double *p)      { return _mm256_loadu_pd(p); }
+	static void store(double *p, vec v)   { _mm256_storeu_pd(p, v); }
+	static vec set1(double v)             { return _mm256_set1_pd(v); }
+	static vec add(vec a, vec b)          { return _mm256_add_pd(a, b); }
+	static vec mul(vec a, vec b)          { return _mm256_mul_pd(a, b); }
+	static vec min(vec a, vec b)          { return _mm256_min_pd(a, b); }
+	static vec max(vec a, vec b)          { return _mm256_max_pd(a, b); }
+};
+
+template <>
+struct CScriptArraySTL_avx2_ops<int>
+{
+	typedef int value_type;
+	typedef __m256i vec;
+	static const size_t width = 8;
+
+	static vec load(const int *p)         { return _mm256_loadu_si256((const __m256i *)p); }
+	static void store(int *p, vec v)      { _mm256_storeu_si256((__m256i *)p, v); }
+	static vec set1(int v)                { return _mm256_set1_epi32(v); }
+	static vec add(vec a, vec b)          { return _mm256_add_epi32(a, b); }
+	static vec mul(vec a, vec b)          { return _mm256_mullo_epi32(a, b); }
+	static vec min(vec a, vec b)          { return _mm256_min_epi32(a, b); }
+	static vec max(vec a, vec b)          { return _mm256_max_epi32(a, b); }
+};
+
+#define SCRIPTARRAYSTL_KERNELS_NAME CScriptArraySTL_kernels_avx2
+#include "ScriptArraySTLKernels.inl"
+#undef SCRIPTARRAYSTL_KERNELS_NAME
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+#endif
+
+// the kernels for one element type on the selected instruction set
+template <class T>
+struct SScriptArraySTLKernelTable
+{
+	T    (*sum)(const T *a, size_t n);
+	T    (*min)(const T *a, size_t n);
+	T    (*max)(const T *a, size_t n);
+	T    (*dot)(const T *a, const T *b, size_t n);
+	void (*axpy)(T alpha, const T *x, T *y, size_t n);
+	void (*clamp)(T *a, size_t n, T lo, T hi);
+	void (*add)(T *a, const T *b, size_t n);
+	void (*mul)(T *a, const T *b, size_t n);
+};
+
+class CScriptArraySTLKernels
+{
+public:
+	enum EInstructionSet
+	{
+		ISA_SCALAR,
+		ISA_SSE2,
+		ISA_AVX2
+	};
+
+	// returns the best instruction set supported by both the build and the CPU
+	static EInstructionSet DetectInstructionSet()
+	{
+#ifdef SCRIPTARRAYSTL_KERNELS_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+		int info[4];
+		__cpuid(info, 0);
+		if(info[0] >= 7)
+		{
+			__cpuid(info, 1);
+			bool os_saves_avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && ((_xgetbv(0) & 6) == 6);
+			__cpuidex(info, 7, 0);
+			if(os_saves_avx && (info[1] & (1 << 5))) return ISA_AVX2;
+		}
+#else
+		__builtin_cpu_init();
+		if(__builtin_cpu_supports("avx2")) return ISA_AVX2;
+#endif
+#endif
+#ifdef SCRIPTARRAYSTL_KERNELS_SSE2
+		return ISA_SSE2;
+#else
+		return ISA_SCALAR;
+#endif
+	}
+
+	// the instruction set the kernels are using
+	static EInstructionSet GetInstructionSet()
+	{
+		return CurrentInstructionSet();
+	}
+
+	// Forces the kernels to a lower instruction set, for example to compare them in benchmarks.
+	// Asking for an instruction set that isn't available selects the best one that is.
+	static void SetInstructionSet(EInstructionSet isa)
+	{
+		EInstructionSet best = DetectInstructionSet();
+		CurrentInstructionSet() = isa < best ? isa : best;
+	}
+
+	// returns the kernels for T on the current instruction set. T must be float, double or int.
+	template <class T>
+	static const SScriptArraySTLKernelTable<T> &Get()
+	{
+		static const SScriptArraySTLKernelTable<T> tables[3] =
+		{
+			MakeTable<CScriptArraySTL_kernels_default<CScriptArraySTL_scalar_ops<T> > >(),
+#ifdef SCRIPTARRAYSTL_KERNELS_SSE2
+			MakeTable<CScriptArraySTL_kernels_default<CScriptArraySTL_sse2_ops<T> > >(),
+#else
+			MakeTable<CScriptArraySTL_kernels_default<CScriptArraySTL_scalar_ops<T> > >(),
+#endif
+#ifdef SCRIPTARRAYSTL_KERNELS_X86
+			MakeTable<CScriptArraySTL_kernels_avx2<CScriptArraySTL_avx2_ops<T> > >()
+#else
+			MakeTable<CScriptArraySTL_kernels_default<CScriptArraySTL_scalar_ops<T> > >()
+#endif
+		};
+		return tables[CurrentInstructionSet()];
+	}
+
+	// Kernels for CScriptArraySTL. min() and max() must not be called on empty arrays and the
+	// arrays passed to the two array kernels must be the same size.
+	template <class T, class A>
+	static T Sum(const CScriptArraySTL<T, A> &a)
+	{
+		return Get<T>().sum(a.data(), a.size());
+	}
+
+	template <class T, class A>
+	static T Min(const CScriptArraySTL<T, A> &a)
+	{
+		return Get<T>().min(a.data(), a.size());
+	}
+
+	template <class T, class A>
+	static T Max(const CScriptArraySTL<T, A> &a)
+	{
+		return Get<T>().max(a.data(), a.size());
+	}
+
+	template <class T, class A, class B>
+	static T Dot(const CScriptArraySTL<T, A> &a, const CScriptArraySTL<T, B> &b)
+	{
+		assert(a.size() == b.size());
+		return Get<T>().dot(a.data(), b.data(), a.size());
+	}
+
+	// y = alpha * x + y
+	template <class T, class A, class B>
+	static void Axpy(T alpha, const CScriptArraySTL<T, A> &x, CScriptArraySTL<T, B> &y)
+	{
+		assert(x.size() == y.size());
+		Get<T>().axpy(alpha, x.data(), y.data(), y.size());
+	}
+
+	template <class T, class A>
+	static void Clamp(CScriptArraySTL<T, A> &a, T lo, T hi)
+	{
+		Get<T>().clamp(a.data(), a.size(), lo, hi);
+	}
+
+	// a = a + b
+	template <class T, class A, class B>
+	static void Add(CScriptArraySTL<T, A> &a, const CScriptArraySTL<T, B> &b)
+	{
+		assert(a.size() == b.size());
+		Get<T>().add(a.data(), b.data(), a.size());
+	}
+
+	// a = a * b
+	template <class T, class A, class B>
+	static void Mul(CScriptArraySTL<T, A> &a, const CScriptArraySTL<T, B> &b)
+	{
+		assert(a.size() == b.size());
+		Get<T>().mul(a.data(), b.data(), a.size());
+	}
+
+private:
+	static EInstructionSet &CurrentInstructionSet()
+	{
+		static EInstructionSet isa = DetectInstructionSet();
+		return isa;
+	}
+
+	template <class K>
+	static SScriptArraySTLKernelTable<typename K::T> MakeTable()
+	{
+		SScriptArraySTLKernelTable<typename K::T> table =
+		{
+			&K::sum, &K::min, &K::max, &K::dot, &K::axpy, &K::clamp, &K::add, &K::mul
+		};
+		return table;
+	}
+};
+
+// Script bindings -------------------------------------------------------------------------------
+// Each generic function looks at the element type of the array it was called on and runs the
+// kernel for it. Arrays of other element types raise a script exception.
+struct CScriptArraySTL_kernel_binding
+{
+	static void SetException(const char *message)
+	{
+		asIScriptContext *ctx = asGetActiveContext();
+		if(ctx) ctx->SetException(message);
+	}
+
+	static bool SameSize(CScriptArray *a, CScriptArray *b)
+	{
+		if(a->GetSize() == b->GetSize()) return true;
+		SetException("Array sizes don't match");
+		return false;
+	}
+
+	template <class T>
+	static void Return(asIScriptGeneric *gen, T value);
+
+	// calls F::template Run<T> with the element type of the array
+	template <class F>
+	static void Dispatch(asIScriptGeneric *gen)
+	{
+		CScriptArray *self = (CScriptArray *)gen->GetObject();
+		switch(self->GetElementTypeId())
+		{
+		case asTYPEID_FLOAT:  F::template Run<float>(gen, self); break;
+		case asTYPEID_DOUBLE: F::template Run<double>(gen, self); break;
+		case asTYPEID_INT32:  F::template Run<int>(gen, self); break;
+		default:              SetException("Operation not supported for this element type"); break;
+		}
+	}
+
+	struct Sum
+	{
+		template <class T> static void Run(asIScriptGeneric *gen, CScriptArray *self)
+		{
+			Return<T>(gen, CScriptArraySTLKernels::Get<T>().sum((const T *)self->GetBuffer(), self->GetSize()));
+		}
+	};
+
+	struct Min
+	{
+		template <class T> static void Run(asIScriptGeneric *gen, CScriptArray *self)
+		{
+			if(self->IsEmpty()) { SetException("Array is empty"); return; }
+			Return<T>(gen, CScriptArraySTLKernels::Get<T>().min((const T *)self->GetBuffer(), self->GetSize()));
+		}
+	};
+
+	struct Max
+	{
+		template <class T> static void Run(asIScriptGeneric *gen, CScriptArray *self)
+		{
+			if(self->IsEmpty()) { SetException("Array is empty"); return; }
+			Return<T>(gen, CScriptArraySTLKernels::Get<T>().max((const T *)self->GetBuffer(), self->GetSize()));
+		}
+	};
+
+	struct Dot
+	{
+		template <class T> static void Run(asIScriptGeneric *gen, CScriptArray *self)
+		{
+			CScriptArray *other = (CScriptArray *)gen->GetArgObject(0);
+			if(!SameSize(self, other)) return;
+			Return<T>(gen, CScriptArraySTLKernels::Get<T>().dot((const T *)self->GetBuffer(), (const T *)other->GetBuffer(), self->GetSize()));
+		}
+	};
+
+	struct Axpy
+	{
+		template <class T> static void Run(asIScriptGeneric *gen, CScriptArray *self)
+		{
+			T alpha = *(T *)gen->GetArgAddress(0);
+			CScriptArray *x = (CScriptArray *)gen->GetArgObject(1);
+			if(!SameSize(self, x)) return;
+			CScriptArraySTLKernels::Get<T>().axpy(alpha, (const T *)x->GetBuffer(), (T *)self->GetBuffer(), self->GetSize());
+		}
+	};
+
+	struct Clamp
+	{
+		template <class T> static void Run(asIScriptGeneric *gen, CScriptArray *self)
+		{
+			T lo = *(T *)gen->GetArgAddress(0);
+			T hi = *(T *)gen->GetArgAddress(1);
+			CScriptArraySTLKernels::Get<T>().clamp((T *)self->GetBuffer(), self->GetSize(), lo, hi);
+		}
+	};
+
+	struct Add
+	{
+		template <class T> static void Run(asIScriptGeneric *gen, CScriptArray *self)
+		{
+			CScriptArray *other = (CScriptArray *)gen->GetArgObject(0);
+			if(!SameSize(self, other)) return;
+			CScriptArraySTLKernels::Get<T>().add((T *)self->GetBuffer(), (const T *)other->GetBuffer(), self->GetSize());
+		}
+	};
+
+	struct Mul
+	{
+		template <class T> static void Run(asIScriptGeneric *gen, CScriptArray *self)
+		{
+			CScriptArray *other = (CScriptArray *)gen->GetArgObject(0);
+			if(!SameSize(self, other)) return;
+			CScriptArraySTLKernels::Get<T>().mul((T *)self->GetBuffer(), (const T *)other->GetBuffer(), self->GetSize());
+		}
+	};
+};
+
+template <> inline void CScriptArraySTL_kernel_binding::Return<float>(asIScriptGeneric *gen, float value)   { gen->SetReturnFloat(value); }
+template <> inline void CScriptArraySTL_kernel_binding::Return<double>(asIScriptGeneric *gen, double value) { gen->SetReturnDouble(value); }
+template <> inline void CScriptArraySTL_kernel_binding::Return<int>(asIScriptGeneric *gen, int value)       { gen->SetReturnDWord((asDWORD)value); }
+
+// Registers the kernels as methods of array<T>. RegisterScriptArray() must be called first.
+inline int RegisterScriptArraySTLKernels(asIScriptEngine *engine)
+{
+	typedef CScriptArraySTL_kernel_binding B;
+	int r;
+
+	r = engine->RegisterObjectMethod("array<T>", "T sum() const", asFUNCTION(B::Dispatch<B::Sum>), asCALL_GENERIC); if(r < 0) return r;
+	r = engine->RegisterObjectMethod("array<T>", "T min() const", asFUNCTION(B::Dispatch<B::Min>), asCALL_GENERIC); if(r < 0) return r;
+	r = engine->RegisterObjectMethod("array<T>", "T max() const", asFUNCTION(B::Dispatch<B::Max>), asCALL_GENERIC); if(r < 0) return r;
+	r = engine->RegisterObjectMethod("array<T>", "T dot(const array<T> &in) const", asFUNCTION(B::Dispatch<B::Dot>), asCALL_GENERIC); if(r < 0) return r;
+	r = engine->RegisterObjectMethod("array<T>", "void axpy(const T &in, const array<T> &in)", asFUNCTION(B::Dispatch<B::Axpy>), asCALL_GENERIC); if(r < 0) return r;
+	r = engine->RegisterObjectMethod("array<T>", "void clamp(const T &in, const T &in)", asFUNCTION(B::Dispatch<B::Clamp>), asCALL_GENERIC); if(r < 0) return r;
+	r = engine->RegisterObjectMethod("array<T>", "void add(const array<T> &in)", asFUNCTION(B::Dispatch<B::Add>), asCALL_GENERIC); if(r < 0) return r;
+	r = engine->RegisterObjectMethod("array<T>", "void mul(const array<T> &in)", asFUNCTION(B::Dispatch<B::Mul>), asCALL_GENERIC); if(r < 0) return r;
+
+	return 0;
+}
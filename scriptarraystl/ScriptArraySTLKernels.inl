@@ -0,0 +1,196 @@
+// Kernel bodies for ScriptArraySTLKernels.h. This file is included once for each instruction set
+// with SCRIPTARRAYSTL_KERNELS_NAME set to the name of the struct to define, so that the compiler
+// generates the code for each instruction set from the same source.
+// V is a vector policy that provides the operations for one element type on one instruction set.
+// Copyright (c) 2014, Dominque A Douglas
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+//    in the documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+// OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+template <class V>
+struct SCRIPTARRAYSTL_KERNELS_NAME
+{
+	typedef typename V::value_type T;
+	typedef typename V::vec        vec;
+	typedef CScriptArraySTL_arith<T> A;
+
+	static T sum(const T *a, size_t n)
+	{
+		// two accumulators so each add doesn't have to wait for the one before it
+		vec s0 = V::set1(T(0));
+		vec s1 = s0;
+		size_t i = 0;
+		for(; i + 2 * V::width <= n; i += 2 * V::width)
+		{
+			s0 = V::add(s0, V::load(a + i));
+			s1 = V::add(s1, V::load(a + i + V::width));
+		}
+		for(; i + V::width <= n; i += V::width)
+		{
+			s0 = V::add(s0, V::load(a + i));
+		}
+		T r = hsum(V::add(s0, s1));
+		for(; i < n; ++i)
+		{
+			r = A::add(r, a[i]);
+		}
+		return r;
+	}
+
+	// n must be greater than 0
+	static T min(const T *a, size_t n)
+	{
+		vec m = V::set1(a[0]);
+		size_t i = 0;
+		for(; i + V::width <= n; i += V::width)
+		{
+			m = V::min(m, V::load(a + i));
+		}
+		T r = hmin(m);
+		for(; i < n; ++i)
+		{
+			if(a[i] < r) r = a[i];
+		}
+		return r;
+	}
+
+	// n must be greater than 0
+	static T max(const T *a, size_t n)
+	{
+		vec m = V::set1(a[0]);
+		size_t i = 0;
+		for(; i + V::width <= n; i += V::width)
+		{
+			m = V::max(m, V::load(a + i));
+		}
+		T r = hmax(m);
+		for(; i < n; ++i)
+		{
+			if(a[i] > r) r = a[i];
+		}
+		return r;
+	}
+
+	static T dot(const T *a, const T *b, size_t n)
+	{
+		vec s0 = V::set1(T(0));
+		vec s1 = s0;
+		size_t i = 0;
+		for(; i + 2 * V::width <= n; i += 2 * V::width)
+		{
+			s0 = V::add(s0, V::mul(V::load(a + i), V::load(b + i)));
+			s1 = V::add(s1, V::mul(V::load(a + i + V::width), V::load(b + i + V::width)));
+		}
+		for(; i + V::width <= n; i += V::width)
+		{
+			s0 = V::add(s0, V::mul(V::load(a + i), V::load(b + i)));
+		}
+		T r = hsum(V::add(s0, s1));
+		for(; i < n; ++i)
+		{
+			r = A::add(r, A::mul(a[i], b[i]));
+		}
+		return r;
+	}
+
+	// y = alpha * x + y
+	static void axpy(T alpha, const T *x, T *y, size_t n)
+	{
+		vec va = V::set1(alpha);
+		size_t i = 0;
+		for(; i + V::width <= n; i += V::width)
+		{
+			V::store(y + i, V::add(V::mul(va, V::load(x + i)), V::load(y + i)));
+		}
+		for(; i < n; ++i)
+		{
+			y[i] = A::add(A::mul(alpha, x[i]), y[i]);
+		}
+	}
+
+	// limits every element to [lo, hi]
+	static void clamp(T *a, size_t n, T lo, T hi)
+	{
+		vec vlo = V::set1(lo);
+		vec vhi = V::set1(hi);
+		size_t i = 0;
+		for(; i + V::width <= n; i += V::width)
+		{
+			V::store(a + i, V::min(V::max(V::load(a + i), vlo), vhi));
+		}
+		for(; i < n; ++i)
+		{
+			if(a[i] < lo) a[i] = lo;
+			if(a[i] > hi) a[i] = hi;
+		}
+	}
+
+	// a = a + b
+	static void add(T *a, const T *b, size_t n)
+	{
+		size_t i = 0;
+		for(; i + V::width <= n; i += V::width)
+		{
+			V::store(a + i, V::add(V::load(a + i), V::load(b + i)));
+		}
+		for(; i < n; ++i)
+		{
+			a[i] = A::add(a[i], b[i]);
+		}
+	}
+
+	// a = a * b
+	static void mul(T *a, const T *b, size_t n)
+	{
+		size_t i = 0;
+		for(; i + V::width <= n; i += V::width)
+		{
+			V::store(a + i, V::mul(V::load(a + i), V::load(b + i)));
+		}
+		for(; i < n; ++i)
+		{
+			a[i] = A::mul(a[i], b[i]);
+		}
+	}
+
+private:
+	// reduce the lanes of a vector to one value
+	static T hsum(vec v)
+	{
+		T tmp[V::width];
+		V::store(tmp, v);
+		T r = tmp[0];
+		for(size_t i = 1; i < V::width; ++i) r = A::add(r, tmp[i]);
+		return r;
+	}
+
+	static T hmin(vec v)
+	{
+		T tmp[V::width];
+		V::store(tmp, v);
+		T r = tmp[0];
+		for(size_t i = 1; i < V::width; ++i) if(tmp[i] < r) r = tmp[i];
+		return r;
+	}
+
+	static T hmax(vec v)
+	{
+		T tmp[V::width];
+		V::store(tmp, v);
+		T r = tmp[0];
+		for(size_t i = 1; i < V::width; ++i) if(tmp[i] > r) r = tmp[i];
+		return r;
+	}
+};
@@ -0,0 +1,209 @@
+// Read only arrays whose elements are computed the first time they are used.
+// CScriptArraySTLLazy holds derived data, such as tables of per-index values, when scripts
+// usually only look at a few of the elements. The elements come from a generator function that
+// fills a block of them at a time. Nothing is computed when the array is created. Reading an
+// element generates its block if it hasn't been generated yet, and the block is kept after that,
+// so memory and time grow with the blocks that are actually used. invalidate() drops every block
+// so they are generated again, for when the data they were computed from changes.
+// Scripts index a normal array<T> straight through its buffer, so an array<T> can't notice which
+// elements are read. RegisterScriptArraySTLLazy() instead registers the container as a read only
+// script type whose methods generate the blocks on demand:
+//     uint length() const
+//     bool isEmpty() const
+//     const T &opIndex(uint) const   (lazy[i])
+// The script type is a reference type without reference counting, so the C++ side owns the
+// container and would usually register it as a global property. copy_to() generates every element
+// and copies them into a CScriptArraySTL for scripts that need a real array<T>.
+// The generator must not throw. A container must only be used by one thread at a time.
+//
+// Example:
+//     CScriptArraySTLLazy<float> noise(1 << 24, [](asUINT first, asUINT count, float *out)
+//     {
+//         for(asUINT i = 0; i < count; ++i) out[i] = Noise(first + i);
+//     });
+//     RegisterScriptArraySTLLazy<CScriptArraySTLLazy<float> >(engine, "noise_t");
+//     engine->RegisterGlobalProperty("const noise_t noise", &noise);
+// Copyright (c) 2014, Dominque A Douglas
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+//    in the documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+// OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <string.h>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ScriptArraySTL.h"
+
+// size of the blocks that are generated together
+#ifndef SCRIPTARRAYSTL_LAZY_BLOCK_BYTES
+#define SCRIPTARRAYSTL_LAZY_BLOCK_BYTES 16384
+#endif
+
+// Lazy array statistics
+struct SScriptArraySTLLazyStats
+{
+	size_t blocks_generated;   // blocks the generator has filled, including ones filled again after invalidate()
+	size_t elements_generated; // elements in those blocks
+	size_t resident_bytes;     // memory currently held by generated blocks
+};
+
+template <class T>
+class CScriptArraySTLLazy
+{
+public:
+	typedef T      value_type;
+	typedef size_t size_type;
+
+	// fills out[0] to out[count - 1] with the elements first to first + count - 1
+	typedef std::function<void (asUINT first, asUINT count, T *out)> generator_type;
+
+	// count elements made by generator, block_elements at a time. With 0 the blocks are about
+	// SCRIPTARRAYSTL_LAZY_BLOCK_BYTES.
+	CScriptArraySTLLazy(asUINT count, const generator_type &generator, asUINT block_elements = 0)
+		:m_count(count), m_generator(generator)
+	{
+		if(block_elements == 0) block_elements = (asUINT)std::max<size_t>(SCRIPTARRAYSTL_LAZY_BLOCK_BYTES / sizeof(T), 1);
+		m_block_elements = block_elements;
+		m_blocks.resize(((size_t)count + block_elements - 1) / block_elements);
+		memset(&m_stats, 0, sizeof(m_stats));
+	}
+
+	size_type size() const
+	{
+		return m_count;
+	}
+
+	bool empty() const
+	{
+		return m_count == 0;
+	}
+
+	// element i, generating its block the first time
+	const T &operator [] (size_type i) const
+	{
+		assert(i < m_count && "Index out of bounds.");
+
+		size_t block = i / m_block_elements;
+		if(!m_blocks[block]) Generate(block);
+		return m_blocks[block][i % m_block_elements];
+	}
+
+	// true if element i has been generated
+	bool generated(size_type i) const
+	{
+		return i < m_count && m_blocks[i / m_block_elements];
+	}
+
+	// Drops every generated block, which frees its memory and has it generated again the next
+	// time it is used
+	void invalidate()
+	{
+		for(size_t b = 0; b < m_blocks.size(); ++b) m_blocks[b].reset();
+		m_stats.resident_bytes = 0;
+	}
+
+	// resizes a to size() and copies every element into it, generating the ones that are missing
+	template <class A>
+	void copy_to(CScriptArraySTL<T, A> &a) const
+	{
+		a.resize(m_count);
+		for(size_t b = 0; b < m_blocks.size(); ++b)
+		{
+			if(!m_blocks[b]) Generate(b);
+
+			size_t first = b * m_block_elements;
+			size_t n = std::min<size_t>(m_block_elements, m_count - first);
+			std::copy(m_blocks[b].get(), m_blocks[b].get() + n, a.begin() + first);
+		}
+	}
+
+	const SScriptArraySTLLazyStats &GetStats() const
+	{
+		return m_stats;
+	}
+
+private:
+	asUINT                                     m_count;
+	asUINT                                     m_block_elements;
+	generator_type                             m_generator;
+	mutable std::vector<std::unique_ptr<T[]> > m_blocks; // empty until the block is generated
+	mutable SScriptArraySTLLazyStats           m_stats;
+
+	void Generate(size_t block) const
+	{
+		// the last block can hold fewer elements than the others
+		asUINT first = (asUINT)(block * m_block_elements);
+		asUINT count = std::min(m_block_elements, m_count - first);
+
+		std::unique_ptr<T[]> elements(new T[count]());
+		m_generator(first, count, elements.get());
+		m_blocks[block] = std::move(elements);
+
+		m_stats.blocks_generated++;
+		m_stats.elements_generated += count;
+		m_stats.resident_bytes += count * sizeof(T);
+	}
+
+	CScriptArraySTLLazy(const CScriptArraySTLLazy &);
+	CScriptArraySTLLazy &operator = (const CScriptArraySTLLazy &);
+};
+
+template <class Lazy>
+struct CScriptArraySTL_lazy_binding
+{
+	static void Length(asIScriptGeneric *gen)
+	{
+		gen->SetReturnDWord((asDWORD)((Lazy *)gen->GetObject())->size());
+	}
+
+	static void IsEmpty(asIScriptGeneric *gen)
+	{
+		gen->SetReturnByte(((Lazy *)gen->GetObject())->empty() ? 1 : 0);
+	}
+
+	static void At(asIScriptGeneric *gen)
+	{
+		Lazy *self = (Lazy *)gen->GetObject();
+		asUINT index = gen->GetArgDWord(0);
+		if(index >= self->size())
+		{
+			asIScriptContext *ctx = asGetActiveContext();
+			if(ctx) ctx->SetException("Index out of bounds");
+			return;
+		}
+		gen->SetReturnAddress((void *)&(*self)[index]);
+	}
+};
+
+// Registers Lazy, a CScriptArraySTLLazy, as the read only script type type_name. The element type
+// must already be registered and have a CScriptArraySTL_type specialization.
+template <class Lazy>
+int RegisterScriptArraySTLLazy(asIScriptEngine *engine, const char *type_name)
+{
+	typedef CScriptArraySTL_lazy_binding<Lazy> B;
+	std::string element = CScriptArraySTL_type<typename Lazy::value_type>::decl();
+	int r;
+
+	r = engine->RegisterObjectType(type_name, 0, asOBJ_REF | asOBJ_NOCOUNT); if(r < 0) return r;
+	r = engine->RegisterObjectMethod(type_name, "uint length() const", asFUNCTION(B::Length), asCALL_GENERIC); if(r < 0) return r;
+	r = engine->RegisterObjectMethod(type_name, "bool isEmpty() const", asFUNCTION(B::IsEmpty), asCALL_GENERIC); if(r < 0) return r;
+	r = engine->RegisterObjectMethod(type_name, ("const " + element + " &opIndex(uint) const").c_str(), asFUNCTION(B::At), asCALL_GENERIC); if(r < 0) return r;
+
+	return 0;
+}
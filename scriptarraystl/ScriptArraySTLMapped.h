@@ -0,0 +1,263 @@
+// Script arrays whose elements are stored in a memory mapped file.
+// CScriptArrayMapped can be used as the TArrayClass of CScriptArraySTL for large tables of a
+// primitive type that are prepared ahead of time with Save(). Open() maps the file instead of
+// reading it, so the elements are only paged in as they are used.
+// READ_ONLY maps the file shared and read only. Every process that opens the same file uses the
+// same physical pages. Writing to an element crashes, so pass these arrays to scripts as
+// const array<T>@.
+// COPY_ON_WRITE maps the file privately. Elements can be changed and the changed pages are copied
+// for this array only. The file is never modified.
+// Either kind can be resized. Growing the array copies it to an ordinary heap buffer.
+// The file starts with a versioned header that records the element type and count, and Open()
+// fails if it doesn't match the array type.
+// Only POSIX systems are supported. CScriptArraySTLMemory::Install() must have been called before
+// any of this is used.
+//
+// Example:
+//     CScriptArrayMapped::Save("weights.bin", weights.GetRef());
+//     ...
+//     CScriptArraySTL<float, CScriptArrayMapped> table(
+//         CScriptArrayMapped::Open<float>(engine, "weights.bin", CScriptArrayMapped::READ_ONLY), false);
+// Copyright (c) 2014, Dominque A Douglas
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+//    in the documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+// OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#ifdef _WIN32
+#error "CScriptArrayMapped requires mmap() and is not available on Windows."
+#endif
+
+#include <stdio.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ScriptArraySTLMemory.h"
+
+// Version of the file header. Files with a different version are rejected.
+#define SCRIPTARRAYMAPPED_VERSION 1
+
+// Offset of the elements in files written by Save(). This is a multiple of every common page size
+// so the elements can be mapped directly.
+#define SCRIPTARRAYMAPPED_DATA_OFFSET 65536
+
+// The header at the start of a file written by Save()
+struct SScriptArrayMappedHeader
+{
+	char    magic[8];         // "ASARRAY"
+	asDWORD version;          // SCRIPTARRAYMAPPED_VERSION
+	asDWORD byte_order;       // 0x01020304 in the byte order of the machine that wrote the file
+	asDWORD header_size;      // sizeof(SScriptArrayMappedHeader)
+	asDWORD element_size;     // size of each element in bytes
+	asQWORD count;            // number of elements
+	asQWORD data_offset;      // offset of the first element from the start of the file
+	char    element_type[32]; // script declaration of the element type, ie "float"
+};
+
+class CScriptArrayMapped : public CScriptArray
+{
+public:
+	enum EMode
+	{
+		READ_ONLY,     // shared between processes, elements can't be changed
+		COPY_ON_WRITE  // private, changes aren't written to the file
+	};
+
+	// Maps a file written by Save() as an array of type t. Returns NULL if it can't. error is set to
+	// -1 if the file can't be opened or mapped, -2 if it isn't an array file of a supported version
+	// or -3 if the element type doesn't match t.
+	static CScriptArrayMapped *Open(asIObjectType *t, const char *path, EMode mode, int *error = NULL)
+	{
+		int fd = open(path, O_RDONLY);
+		if(fd < 0) return Fail(error, -1);
+
+		SScriptArrayMappedHeader header;
+		struct stat st;
+		if(fstat(fd, &st) != 0 || pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header))
+		{
+			close(fd);
+			return Fail(error, -2);
+		}
+
+		int result = CheckHeader(t, header, (asQWORD)st.st_size);
+		if(result != 0)
+		{
+			close(fd);
+			return Fail(error, result);
+		}
+
+		// Reserve one page in front of the elements for the buffer header, which is always
+		// writable, then map the elements over the rest of the range.
+		size_t page = (size_t)sysconf(_SC_PAGESIZE);
+		size_t data_length = (size_t)(header.count * header.element_size);
+		size_t length = page + data_length;
+		if((header.data_offset % page) != 0)
+		{
+			close(fd);
+			return Fail(error, -2);
+		}
+
+		void *address = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if(address == MAP_FAILED)
+		{
+			close(fd);
+			return Fail(error, -1);
+		}
+
+		char *elements = (char *)address + page;
+		if(data_length > 0)
+		{
+			int prot = mode == READ_ONLY ? PROT_READ : PROT_READ | PROT_WRITE;
+			int flags = (mode == READ_ONLY ? MAP_SHARED : MAP_PRIVATE) | MAP_FIXED;
+			if(mmap(elements, data_length, prot, flags, fd, (off_t)header.data_offset) == MAP_FAILED)
+			{
+				munmap(address, length);
+				close(fd);
+				return Fail(error, -1);
+			}
+		}
+		close(fd);
+
+		if(error) *error = 0;
+		return new CScriptArrayMapped(t, (char *)address, length, elements, (asUINT)header.count);
+	}
+
+	// Maps a file as the array<T> type for the engine
+	template <class T>
+	static CScriptArrayMapped *Open(asIScriptEngine *engine, const char *path, EMode mode, int *error = NULL)
+	{
+		asIObjectType *t = CScriptArraySTLTypeCache::GetArrayType<T>(engine, error);
+		if(t == NULL) return NULL;
+
+		return Open(t, path, mode, error);
+	}
+
+	// Writes an array of a primitive type to a file that Open() can map. Returns 0 on success, -1
+	// if the file can't be written or -3 if the element type isn't a primitive type.
+	static int Save(const char *path, CScriptArray *as_array)
+	{
+		asIScriptEngine *engine = as_array->GetArrayObjectType()->GetEngine();
+		int sub_type_id = as_array->GetElementTypeId();
+		const char *decl = engine->GetTypeDeclaration(sub_type_id);
+		if((sub_type_id & asTYPEID_MASK_OBJECT) || decl == NULL || strlen(decl) >= sizeof(SScriptArrayMappedHeader().element_type)) return -3;
+
+		SScriptArrayMappedHeader header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, "ASARRAY", 8);
+		header.version = SCRIPTARRAYMAPPED_VERSION;
+		header.byte_order = 0x01020304;
+		header.header_size = sizeof(header);
+		header.element_size = (asDWORD)engine->GetSizeOfPrimitiveType(sub_type_id);
+		header.count = as_array->GetSize();
+		header.data_offset = SCRIPTARRAYMAPPED_DATA_OFFSET;
+		strcpy(header.element_type, decl);
+
+		FILE *file = fopen(path, "wb");
+		if(file == NULL) return -1;
+
+		size_t data_length = (size_t)(header.count * header.element_size);
+		bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+			fseek(file, (long)header.data_offset, SEEK_SET) == 0 &&
+			(data_length == 0 || fwrite(as_array->GetBuffer(), data_length, 1, file) == 1);
+		ok = (fclose(file) == 0) && ok;
+
+		return ok ? 0 : -1;
+	}
+
+	virtual ~CScriptArrayMapped()
+	{
+		// the buffer header is in the mapping, so the buffer is released before it is unmapped
+		if(IsMapped())
+		{
+			DeleteBuffer(buffer);
+			buffer = NULL;
+		}
+		munmap(m_address, m_length);
+	}
+
+	// allocated like a CScriptArray, since Release() frees it with the array add-on's memory functions
+	static void *operator new(size_t size)
+	{
+		return CScriptArraySTLMemory::AllocArray(size);
+	}
+
+	static void operator delete(void *ptr)
+	{
+		CScriptArraySTLMemory::FreeArray(ptr);
+	}
+
+	// true while the elements are still the ones in the mapped file. Growing the array moves
+	// them to the heap.
+	bool IsMapped() const
+	{
+		return buffer != NULL && (const char *)buffer->data == m_elements;
+	}
+
+private:
+	char   *m_address;  // start of the reserved range
+	size_t  m_length;   // length of the reserved range
+	char   *m_elements; // where the elements are mapped
+
+	CScriptArrayMapped(asIObjectType *t, char *address, size_t length, char *elements, asUINT count)
+		:CScriptArray(0, t), m_address(address), m_length(length), m_elements(elements)
+	{
+		assert(CScriptArraySTLMemory::IsInstalled() && "CScriptArraySTLMemory::Install() must be called first.");
+
+		// Replace the empty buffer with one whose header is at the end of the reserved page, right
+		// in front of the mapped elements. The block is marked as owned by the array, so when
+		// CScriptArray moves to a bigger buffer it isn't freed.
+		char *block = elements - offsetof(SArrayBuffer, data) - sizeof(SScriptArraySTLBlock);
+		SArrayBuffer *mapped = (SArrayBuffer *)CScriptArraySTLMemory::InitBlock(block, sizeof(SScriptArraySTLBlock) + offsetof(SArrayBuffer, data), CScriptArraySTLOwnedSource::Get());
+		mapped->numElements = count;
+		mapped->maxElements = count;
+		DeleteBuffer(buffer);
+		buffer = mapped;
+	}
+
+	CScriptArrayMapped(const CScriptArrayMapped &);
+	CScriptArrayMapped &operator = (const CScriptArrayMapped &);
+
+	static CScriptArrayMapped *Fail(int *error, int code)
+	{
+		if(error) *error = code;
+		return NULL;
+	}
+
+	static int CheckHeader(asIObjectType *t, const SScriptArrayMappedHeader &header, asQWORD file_size)
+	{
+		if(memcmp(header.magic, "ASARRAY", 8) != 0 || header.version != SCRIPTARRAYMAPPED_VERSION ||
+			header.byte_order != 0x01020304 || header.header_size != sizeof(header))
+		{
+			return -2;
+		}
+
+		asIScriptEngine *engine = t->GetEngine();
+		int sub_type_id = t->GetSubTypeId();
+		const char *decl = engine->GetTypeDeclaration(sub_type_id);
+		if((sub_type_id & asTYPEID_MASK_OBJECT) || decl == NULL ||
+			strncmp(decl, header.element_type, sizeof(header.element_type)) != 0 ||
+			header.element_size != (asDWORD)engine->GetSizeOfPrimitiveType(sub_type_id))
+		{
+			return -3;
+		}
+
+		// the file has to hold all of the elements, and the count has to fit in the array
+		if(header.count > 0xFFFFFFFFu || (header.count > 0 && header.data_offset + header.count * header.element_size > file_size)) return -2;
+
+		return 0;
+	}
+};
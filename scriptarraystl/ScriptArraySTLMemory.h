@@ -0,0 +1,210 @@
+// Memory routines for the CScriptArray add-on that let array buffers come from sources other than
+// the default heap (arenas, inline storage, mapped files, ...).
+// CScriptArraySTLMemory::Install() must be called before any script array is created. After that
+// every block the array add-on allocates carries a small header recording which source it came
+// from, so it is always returned to the right place no matter whether it is freed by C++ code or
+// by a script that resized the array.
+// A source is used for new allocations on a thread while a CScriptArraySTLSourceScope for it is
+// alive. Allocations made without a source, or that the source refuses, use asAllocMem().
+// CScriptArray::Release() frees the array object itself with the same free function, so array
+// classes derived from CScriptArray allocate their objects with AllocArray() from their own
+// operator new, and CScriptArraySTL creates plain arrays with CScriptArray::Create().
+// Copyright (c) 2014, Dominque A Douglas
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+//    in the documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+// OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <stddef.h>
+#include <new>
+
+#include "ScriptArraySTL.h"
+
+class CScriptArraySTLBufferSource;
+
+// placed in front of every block handed to the array add-on
+struct SScriptArraySTLBlock
+{
+	CScriptArraySTLBufferSource *source; // NULL when the block came from asAllocMem()
+	size_t                       size;   // size of the block including this header
+
+	// keeps the memory after the header aligned the same as asAllocMem()'s
+	void *padding[2];
+};
+
+// Something that can provide memory for script array buffers
+class CScriptArraySTLBufferSource
+{
+public:
+	virtual ~CScriptArraySTLBufferSource() {}
+
+	// returns a block of at least size bytes, or NULL to let the default allocator handle it
+	virtual void *AllocateBlock(size_t size) = 0;
+
+	// called when a block that came from AllocateBlock() is freed
+	virtual void FreeBlock(void *block, size_t size) = 0;
+};
+
+class CScriptArraySTLMemory
+{
+public:
+	// Sets the array add-on's memory functions. Must be called before any script array is created,
+	// since blocks allocated before this don't have a header.
+	static void Install()
+	{
+		CScriptArray::SetMemoryFunctions(Alloc, Free);
+		Installed() = true;
+	}
+
+	static bool IsInstalled()
+	{
+		return Installed();
+	}
+
+	// returns the source used for allocations made on this thread
+	static CScriptArraySTLBufferSource *GetSource()
+	{
+		return CurrentSource();
+	}
+
+	// sets the source used for allocations made on this thread and returns the previous one
+	static CScriptArraySTLBufferSource *SetSource(CScriptArraySTLBufferSource *source)
+	{
+		CScriptArraySTLBufferSource *previous = CurrentSource();
+		CurrentSource() = source;
+		return previous;
+	}
+
+	// returns the header of a block returned by Alloc()
+	static SScriptArraySTLBlock *GetBlock(void *ptr)
+	{
+		return (SScriptArraySTLBlock *)ptr - 1;
+	}
+
+	// Writes a block header at the start of memory that is owned by source and returns the
+	// address just past it. Used by sources that hand out memory without going through Alloc().
+	static void *InitBlock(void *memory, size_t size, CScriptArraySTLBufferSource *source)
+	{
+		SScriptArraySTLBlock *block = (SScriptArraySTLBlock *)memory;
+		block->source = source;
+		block->size = size;
+		return block + 1;
+	}
+
+	static void *Alloc(size_t size)
+	{
+		size_t block_size = sizeof(SScriptArraySTLBlock) + size;
+		CScriptArraySTLBufferSource *source = CurrentSource();
+		void *memory = NULL;
+
+		if(source != NULL) memory = source->AllocateBlock(block_size);
+		if(memory == NULL)
+		{
+			// no source or the source couldn't provide the memory
+			source = NULL;
+			memory = asAllocMem(block_size);
+			if(memory == NULL) return NULL;
+		}
+
+		return InitBlock(memory, block_size, source);
+	}
+
+	static void Free(void *ptr)
+	{
+		if(ptr == NULL) return;
+
+		SScriptArraySTLBlock *block = GetBlock(ptr);
+		if(block->source != NULL)
+		{
+			block->source->FreeBlock(block, block->size);
+		}
+		else
+		{
+			asFreeMem(block);
+		}
+	}
+
+	// Allocates the object of an array class derived from CScriptArray, the same way the array
+	// add-on allocates a CScriptArray, so that Release() can free it
+	static void *AllocArray(size_t size)
+	{
+		void *ptr = IsInstalled() ? Alloc(size) : asAllocMem(size);
+		if(ptr == NULL) throw std::bad_alloc();
+		return ptr;
+	}
+
+	// frees an object allocated with AllocArray() whose constructor threw
+	static void FreeArray(void *ptr)
+	{
+		if(IsInstalled()) Free(ptr);
+		else asFreeMem(ptr);
+	}
+
+private:
+	static CScriptArraySTLBufferSource *&CurrentSource()
+	{
+		static thread_local CScriptArraySTLBufferSource *source = NULL;
+		return source;
+	}
+
+	static bool &Installed()
+	{
+		static bool installed = false;
+		return installed;
+	}
+};
+
+// The source that blocks owned by an array object are marked with (inline storage, mapped files,
+// ...). The array class frees that memory itself, so freeing one of these blocks through the array
+// add-on does nothing.
+class CScriptArraySTLOwnedSource : public CScriptArraySTLBufferSource
+{
+public:
+	static CScriptArraySTLOwnedSource *Get()
+	{
+		static CScriptArraySTLOwnedSource source;
+		return &source;
+	}
+
+	virtual void *AllocateBlock(size_t)
+	{
+		return NULL;
+	}
+
+	virtual void FreeBlock(void *, size_t)
+	{
+	}
+};
+
+// Makes a source current on this thread for the lifetime of the scope
+class CScriptArraySTLSourceScope
+{
+public:
+	explicit CScriptArraySTLSourceScope(CScriptArraySTLBufferSource *source)
+		:m_previous(CScriptArraySTLMemory::SetSource(source))
+	{
+	}
+
+	~CScriptArraySTLSourceScope()
+	{
+		CScriptArraySTLMemory::SetSource(m_previous);
+	}
+
+private:
+	CScriptArraySTLBufferSource *m_previous;
+
+	CScriptArraySTLSourceScope(const CScriptArraySTLSourceScope &);
+	CScriptArraySTLSourceScope &operator = (const CScriptArraySTLSourceScope &);
+};
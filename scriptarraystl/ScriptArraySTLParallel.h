@@ -0,0 +1,388 @@
+// Parallel algorithms for CScriptArraySTL.
+// parallel_for_each, parallel_transform and parallel_reduce split an array into chunks and run
+// them on a work-stealing thread pool. The calling thread works on chunks too and the call
+// returns when every chunk is done.
+//
+// Script arrays must only be touched by the engine on the thread that owns them. These functions
+// get everything they need from the array (the buffer, the size, the output resize) on the calling
+// thread before any work starts, and the pool threads only ever see references to elements. No
+// AddRef, Release, Resize or other engine call is made off the calling thread. The functions
+// passed in must keep to the same rule, so they can't change the arrays' sizes, call script
+// functions or add and release references (ie to the objects in an array of handles).
+//
+// Chunks are sized to about SCRIPTARRAYSTL_PARALLEL_CHUNK_BYTES of elements, with at least a
+// few chunks per thread so idle threads have work to steal. Arrays smaller than one chunk are
+// processed on the calling thread.
+// Copyright (c) 2014, Dominque A Douglas
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+//    in the documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+// OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <stddef.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ScriptArraySTL.h"
+
+#ifndef SCRIPTARRAYSTL_PARALLEL_CHUNK_BYTES
+#define SCRIPTARRAYSTL_PARALLEL_CHUNK_BYTES 65536
+#endif
+
+// Thread pool where each thread has its own queue of chunks. Threads take chunks from the front
+// of their own queue and, when it is empty, steal from the back of another thread's queue.
+class CScriptArraySTLThreadPool
+{
+public:
+	// threads is the number of threads created in addition to the calling thread
+	explicit CScriptArraySTLThreadPool(size_t threads = DefaultThreadCount())
+		:m_pending(0), m_stop(false)
+	{
+		for(size_t i = 0; i < threads; ++i) m_workers.push_back(std::unique_ptr<Worker>(new Worker()));
+		for(size_t i = 0; i < threads; ++i) m_workers[i]->thread = std::thread(&CScriptArraySTLThreadPool::WorkerLoop, this, i);
+	}
+
+	// waits for the threads to finish. Must not be called while a ParallelFor is running.
+	~CScriptArraySTLThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_wake_mutex);
+			m_stop = true;
+		}
+		m_wake.notify_all();
+		for(size_t i = 0; i < m_workers.size(); ++i) m_workers[i]->thread.join();
+	}
+
+	// the pool used by the parallel algorithms. It is created on first use with one thread less
+	// than the hardware supports, since the calling thread also does work, or with
+	// SCRIPTARRAYSTL_PARALLEL_THREADS threads if that is defined.
+	static CScriptArraySTLThreadPool &Get()
+	{
+#ifdef SCRIPTARRAYSTL_PARALLEL_THREADS
+		static CScriptArraySTLThreadPool pool(SCRIPTARRAYSTL_PARALLEL_THREADS);
+#else
+		static CScriptArraySTLThreadPool pool;
+#endif
+		return pool;
+	}
+
+	static size_t DefaultThreadCount()
+	{
+		unsigned int n = std::thread::hardware_concurrency();
+		return n > 1 ? n - 1 : 0;
+	}
+
+	// the number of threads that work on a ParallelFor, including the calling thread
+	size_t GetThreadCount() const
+	{
+		return m_workers.size() + 1;
+	}
+
+	// Calls body(begin, end) for the chunks [0, grain), [grain, 2 * grain) ... of [0, count).
+	// Returns when every chunk is done. If body throws, the remaining chunks still run and the
+	// first exception is rethrown here.
+	template <class F>
+	void ParallelFor(size_t count, size_t grain, F body)
+	{
+		if(grain == 0) grain = 1;
+		size_t chunks = (count + grain - 1) / grain;
+		if(chunks == 0) return;
+		if(chunks == 1 || m_workers.empty())
+		{
+			for(size_t begin = 0; begin < count; begin += grain) body(begin, std::min(count, begin + grain));
+			return;
+		}
+
+		Job job;
+		job.run = &Invoke<F>;
+		job.context = &body;
+		job.remaining.store(chunks);
+
+		{
+			std::lock_guard<std::mutex> lock(m_wake_mutex);
+			m_pending += chunks;
+		}
+
+		// each thread gets a contiguous run of chunks so neighbouring chunks stay on one thread
+		size_t threads = m_workers.size();
+		for(size_t w = 0; w < threads; ++w)
+		{
+			Worker &worker = *m_workers[w];
+			std::lock_guard<std::mutex> lock(worker.mutex);
+			for(size_t c = chunks * w / threads; c < chunks * (w + 1) / threads; ++c)
+			{
+				Task task = { &job, c * grain, std::min(count, (c + 1) * grain) };
+				worker.tasks.push_back(task);
+			}
+		}
+		m_wake.notify_all();
+
+		// help until every chunk is done
+		while(job.remaining.load(std::memory_order_acquire) != 0)
+		{
+			Task task;
+			if(PopOwn(CurrentWorker(), task) || Steal(CurrentWorker(), task)) Execute(task);
+			else
+			{
+				std::unique_lock<std::mutex> lock(m_wake_mutex);
+				m_done.wait(lock, [&job] { return job.remaining.load(std::memory_order_acquire) == 0; });
+			}
+		}
+
+		if(job.error) std::rethrow_exception(job.error);
+	}
+
+private:
+	struct Job
+	{
+		void (*run)(void *context, size_t begin, size_t end);
+		void *context;
+		std::atomic<size_t> remaining;
+		std::mutex error_mutex;
+		std::exception_ptr error;
+	};
+
+	struct Task
+	{
+		Job *job;
+		size_t begin;
+		size_t end;
+	};
+
+	struct Worker
+	{
+		std::mutex mutex;
+		std::deque<Task> tasks;
+		std::thread thread;
+	};
+
+	template <class F>
+	static void Invoke(void *context, size_t begin, size_t end)
+	{
+		(*(F *)context)(begin, end);
+	}
+
+	// index of the pool worker running on this thread, or -1 for other threads
+	size_t &CurrentWorker()
+	{
+		static thread_local size_t index = (size_t)-1;
+		return index;
+	}
+
+	void Execute(const Task &task)
+	{
+		Job *job = task.job;
+		try
+		{
+			job->run(job->context, task.begin, task.end);
+		}
+		catch(...)
+		{
+			std::lock_guard<std::mutex> lock(job->error_mutex);
+			if(!job->error) job->error = std::current_exception();
+		}
+
+		// the job may be destroyed by the thread waiting on it as soon as this reaches zero
+		if(job->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			std::lock_guard<std::mutex> lock(m_wake_mutex);
+			m_done.notify_all();
+		}
+	}
+
+	bool PopOwn(size_t self, Task &task)
+	{
+		if(self >= m_workers.size()) return false;
+
+		Worker &worker = *m_workers[self];
+		std::lock_guard<std::mutex> lock(worker.mutex);
+		if(worker.tasks.empty()) return false;
+		task = worker.tasks.front();
+		worker.tasks.pop_front();
+		m_pending.fetch_sub(1);
+		return true;
+	}
+
+	bool Steal(size_t self, Task &task)
+	{
+		size_t threads = m_workers.size();
+		size_t start = self < threads ? self + 1 : 0;
+		for(size_t i = 0; i < threads; ++i)
+		{
+			size_t victim = (start + i) % threads;
+			if(victim == self) continue;
+
+			Worker &worker = *m_workers[victim];
+			std::lock_guard<std::mutex> lock(worker.mutex);
+			if(worker.tasks.empty()) continue;
+			task = worker.tasks.back();
+			worker.tasks.pop_back();
+			m_pending.fetch_sub(1);
+			return true;
+		}
+		return false;
+	}
+
+	void WorkerLoop(size_t self)
+	{
+		CurrentWorker() = self;
+		for(;;)
+		{
+			Task task;
+			if(PopOwn(self, task) || Steal(self, task))
+			{
+				Execute(task);
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(m_wake_mutex);
+			m_wake.wait(lock, [this] { return m_stop || m_pending.load() > 0; });
+			if(m_stop) return;
+		}
+	}
+
+	CScriptArraySTLThreadPool(const CScriptArraySTLThreadPool &);
+	CScriptArraySTLThreadPool &operator = (const CScriptArraySTLThreadPool &);
+
+	std::vector<std::unique_ptr<Worker> > m_workers;
+	std::mutex m_wake_mutex;
+	std::condition_variable m_wake;  // work was added or the pool is stopping
+	std::condition_variable m_done;  // a job finished
+	std::atomic<size_t> m_pending;   // tasks queued and not yet taken
+	bool m_stop;
+};
+
+// Element access that is safe to hand to pool threads. It is made from the array on the calling
+// thread and only holds the address of the buffer, so using it never calls the engine.
+template <class T, bool contiguous = CScriptArraySTL_is_contiguous<T>::value>
+class CScriptArraySTL_span
+{
+public:
+	template <class A>
+	explicit CScriptArraySTL_span(const CScriptArraySTL<T, A> &a)
+		:m_data((T *)const_cast<CScriptArraySTL<T, A> &>(a).GetRef()->GetBuffer()), m_size(a.size())
+	{
+	}
+
+	size_t size() const { return m_size; }
+	T &operator [] (size_t i) const { return m_data[i]; }
+
+private:
+	T *m_data;
+	size_t m_size;
+};
+
+// object types are stored as pointers to the objects
+template <class T>
+class CScriptArraySTL_span<T, false>
+{
+public:
+	template <class A>
+	explicit CScriptArraySTL_span(const CScriptArraySTL<T, A> &a)
+		:m_slots((T **)const_cast<CScriptArraySTL<T, A> &>(a).GetRef()->GetBuffer()), m_size(a.size())
+	{
+	}
+
+	size_t size() const { return m_size; }
+	T &operator [] (size_t i) const { return *m_slots[i]; }
+
+private:
+	T **m_slots;
+	size_t m_size;
+};
+
+// returns the number of elements in each chunk for an array of n elements of T
+template <class T>
+size_t ScriptArraySTL_ParallelGrain(size_t n, const CScriptArraySTLThreadPool &pool)
+{
+	size_t grain = std::max<size_t>(1, SCRIPTARRAYSTL_PARALLEL_CHUNK_BYTES / sizeof(T));
+
+	// once the array is big enough to split, make at least four chunks per thread
+	if(n > grain)
+	{
+		size_t chunks = pool.GetThreadCount() * 4;
+		grain = std::max<size_t>(grain / 8, std::min(grain, (n + chunks - 1) / chunks));
+	}
+	return grain;
+}
+
+// calls f(element) for every element in the array
+template <class T, class A, class F>
+void parallel_for_each(CScriptArraySTL<T, A> &a, F f)
+{
+	CScriptArraySTLThreadPool &pool = CScriptArraySTLThreadPool::Get();
+	CScriptArraySTL_span<T> span(a);
+
+	pool.ParallelFor(span.size(), ScriptArraySTL_ParallelGrain<T>(span.size(), pool), [&span, &f](size_t begin, size_t end)
+	{
+		for(size_t i = begin; i < end; ++i) f(span[i]);
+	});
+}
+
+// sets out[i] = f(in[i]) for every element. out is resized to the size of in first, on the
+// calling thread. in and out may be the same array.
+template <class T, class A, class U, class B, class F>
+void parallel_transform(const CScriptArraySTL<T, A> &in, CScriptArraySTL<U, B> &out, F f)
+{
+	if(out.size() != in.size()) out.resize(in.size());
+
+	CScriptArraySTLThreadPool &pool = CScriptArraySTLThreadPool::Get();
+	CScriptArraySTL_span<T> src(in);
+	CScriptArraySTL_span<U> dst(out);
+
+	pool.ParallelFor(src.size(), ScriptArraySTL_ParallelGrain<T>(src.size(), pool), [&src, &dst, &f](size_t begin, size_t end)
+	{
+		for(size_t i = begin; i < end; ++i) dst[i] = f(src[i]);
+	});
+}
+
+// Combines every element with reduce(R, R) after converting it with map(const T &), and
+// returns reduce(init, ...). reduce must be associative. The elements are combined in a fixed
+// order that depends only on the array size and the pool, so floating point results are the
+// same from run to run.
+template <class T, class A, class R, class Reduce, class Map>
+R parallel_reduce(const CScriptArraySTL<T, A> &a, R init, Reduce reduce, Map map)
+{
+	CScriptArraySTLThreadPool &pool = CScriptArraySTLThreadPool::Get();
+	CScriptArraySTL_span<T> span(a);
+	size_t grain = ScriptArraySTL_ParallelGrain<T>(span.size(), pool);
+
+	std::vector<R> partials((span.size() + grain - 1) / grain, init);
+	pool.ParallelFor(span.size(), grain, [&span, &partials, &reduce, &map, grain](size_t begin, size_t end)
+	{
+		R partial = map(span[begin]);
+		for(size_t i = begin + 1; i < end; ++i) partial = reduce(partial, map(span[i]));
+		partials[begin / grain] = partial;
+	});
+
+	R result = init;
+	for(size_t i = 0; i < partials.size(); ++i) result = reduce(result, partials[i]);
+	return result;
+}
+
+// Same as above with the elements used as they are, ie
+//     double total = parallel_reduce(values, 0.0, std::plus<double>());
+template <class T, class A, class R, class Reduce>
+R parallel_reduce(const CScriptArraySTL<T, A> &a, R init, Reduce reduce)
+{
+	return parallel_reduce(a, init, reduce, [](const T &v) -> R { return R(v); });
+}
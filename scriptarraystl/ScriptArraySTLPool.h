@@ -0,0 +1,336 @@
+// Recycling of script arrays that are created and released over and over.
+// CScriptArrayPooled can be used as the TArrayClass of CScriptArraySTL. When a CScriptArraySTL
+// releases the last reference to one, the array is emptied and kept in a pool instead of being
+// deleted, and the next InitArray() for the same array type takes it back with the capacity it
+// had. Each engine has its own pool, which holds a separate list for every array type. Arrays that
+// scripts still hold a reference to when the C++ side releases them are deleted as usual when the
+// script lets go of them.
+// SetLimits() bounds how many arrays and how much buffer memory a pool keeps, and Trim() releases
+// pooled arrays, for example after a burst of requests. The pool is emptied when the engine is
+// released.
+//
+// Example:
+//     CScriptArraySTLPool::Get(engine).SetLimits(limits);
+//     ...
+//     CScriptArraySTL<float, CScriptArrayPooled> samples;
+//     samples.InitArray(engine, 256);
+//     ... call the script with samples.GetRef() ...
+//     samples.Release(); // goes back to the pool
+// Copyright (c) 2014, Dominque A Douglas
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+//    in the documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+// OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "ScriptArraySTLMemory.h"
+
+// engine user data slot used for the pool
+#ifndef SCRIPTARRAYSTL_POOL
+#define SCRIPTARRAYSTL_POOL 0x53544C01
+#endif
+
+// A script array that CScriptArraySTL gives back to the engine's pool instead of deleting.
+// To scripts it is a normal array<T>.
+class CScriptArrayPooled : public CScriptArray
+{
+public:
+	CScriptArrayPooled(asUINT length, asIObjectType *ot)
+		:CScriptArray(length, ot)
+	{
+	}
+
+	// allocated like a CScriptArray, since Release() frees it with the array add-on's memory functions
+	static void *operator new(size_t size)
+	{
+		return CScriptArraySTLMemory::AllocArray(size);
+	}
+
+	static void operator delete(void *ptr)
+	{
+		CScriptArraySTLMemory::FreeArray(ptr);
+	}
+
+	// true if the caller's reference is the only one
+	bool IsUnique() const
+	{
+		return refCount == 1;
+	}
+
+	// bytes reserved for the elements
+	size_t GetCapacityBytes() const
+	{
+		return (size_t)buffer->maxElements * elementSize;
+	}
+};
+
+// Limits for what a pool keeps. Arrays that would go past them are deleted instead.
+struct SScriptArraySTLPoolLimits
+{
+	size_t max_arrays_per_type; // arrays kept for each array type
+	size_t max_array_bytes;     // arrays that have reserved more than this aren't kept
+	size_t max_total_bytes;     // reserved bytes of all of the arrays in the pool
+
+	SScriptArraySTLPoolLimits()
+		:max_arrays_per_type(64), max_array_bytes(64 * 1024), max_total_bytes(4 * 1024 * 1024)
+	{
+	}
+};
+
+// Pool statistics, for one array type or summed over all of them
+struct SScriptArraySTLPoolStats
+{
+	size_t hits;          // InitArray() calls that were given a pooled array
+	size_t misses;        // InitArray() calls that had to create a new array
+	size_t recycled;      // arrays put in the pool
+	size_t discarded;     // arrays that were deleted because of the limits
+	size_t trimmed;       // arrays released by Trim()
+	size_t pooled_arrays; // arrays in the pool now
+	size_t pooled_bytes;  // bytes reserved by the arrays in the pool now
+
+	void Add(const SScriptArraySTLPoolStats &other)
+	{
+		hits += other.hits;
+		misses += other.misses;
+		recycled += other.recycled;
+		discarded += other.discarded;
+		trimmed += other.trimmed;
+		pooled_arrays += other.pooled_arrays;
+		pooled_bytes += other.pooled_bytes;
+	}
+};
+
+class CScriptArraySTLPool
+{
+public:
+	// returns the engine's pool, creating it the first time
+	static CScriptArraySTLPool &Get(asIScriptEngine *engine)
+	{
+		asAcquireSharedLock();
+		CScriptArraySTLPool *pool = (CScriptArraySTLPool *)engine->GetUserData(SCRIPTARRAYSTL_POOL);
+		asReleaseSharedLock();
+		if(pool != NULL) return *pool;
+
+		asAcquireExclusiveLock();
+		pool = (CScriptArraySTLPool *)engine->GetUserData(SCRIPTARRAYSTL_POOL);
+		if(pool == NULL)
+		{
+			pool = new CScriptArraySTLPool();
+			engine->SetUserData(pool, SCRIPTARRAYSTL_POOL);
+			engine->SetEngineUserDataCleanupCallback(CleanupEngine, SCRIPTARRAYSTL_POOL);
+		}
+		asReleaseExclusiveLock();
+
+		return *pool;
+	}
+
+	~CScriptArraySTLPool()
+	{
+		Trim();
+	}
+
+	// Takes an array of type t out of the pool and resizes it to length. Returns NULL if there is
+	// none, in which case the caller creates a new one.
+	CScriptArrayPooled *Acquire(asIObjectType *t, asUINT length)
+	{
+		CScriptArrayPooled *as_array = NULL;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			SList &list = m_lists[t];
+			if(list.arrays.empty())
+			{
+				list.stats.misses++;
+				return NULL;
+			}
+
+			as_array = list.arrays.back();
+			list.arrays.pop_back();
+			size_t bytes = as_array->GetCapacityBytes();
+			list.stats.hits++;
+			list.stats.pooled_arrays--;
+			list.stats.pooled_bytes -= bytes;
+			m_total_bytes -= bytes;
+		}
+
+		as_array->Resize(length);
+		return as_array;
+	}
+
+	// Takes over a reference to an array. If it was the last one and the limits allow it, the
+	// array is emptied and kept, otherwise the reference is released.
+	void Recycle(CScriptArrayPooled *as_array)
+	{
+		if(!as_array->IsUnique())
+		{
+			as_array->Release();
+			return;
+		}
+
+		// the elements are destroyed outside of the lock since that can release other objects
+		as_array->Resize(0);
+
+		size_t bytes = as_array->GetCapacityBytes();
+		bool keep;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			SList &list = m_lists[as_array->GetArrayObjectType()];
+			keep = list.arrays.size() < m_limits.max_arrays_per_type &&
+				bytes <= m_limits.max_array_bytes &&
+				m_total_bytes + bytes <= m_limits.max_total_bytes;
+
+			if(keep)
+			{
+				list.arrays.push_back(as_array);
+				list.stats.recycled++;
+				list.stats.pooled_arrays++;
+				list.stats.pooled_bytes += bytes;
+				m_total_bytes += bytes;
+			}
+			else
+			{
+				list.stats.discarded++;
+			}
+		}
+
+		if(!keep) as_array->Release();
+	}
+
+	// Releases pooled arrays until at most keep_per_type are left for each array type. Returns the
+	// number of arrays released.
+	size_t Trim(size_t keep_per_type = 0)
+	{
+		std::vector<CScriptArrayPooled *> released;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			for(std::map<asIObjectType *, SList>::iterator it = m_lists.begin(); it != m_lists.end(); ++it)
+			{
+				SList &list = it->second;
+				while(list.arrays.size() > keep_per_type)
+				{
+					CScriptArrayPooled *as_array = list.arrays.back();
+					list.arrays.pop_back();
+
+					size_t bytes = as_array->GetCapacityBytes();
+					list.stats.trimmed++;
+					list.stats.pooled_arrays--;
+					list.stats.pooled_bytes -= bytes;
+					m_total_bytes -= bytes;
+					released.push_back(as_array);
+				}
+			}
+		}
+
+		for(size_t i = 0; i < released.size(); ++i)
+		{
+			released[i]->Release();
+		}
+		return released.size();
+	}
+
+	// Changes the limits. Arrays that are already pooled stay until they are taken or trimmed.
+	void SetLimits(const SScriptArraySTLPoolLimits &limits)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_limits = limits;
+	}
+
+	SScriptArraySTLPoolLimits GetLimits() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_limits;
+	}
+
+	// statistics for one array type
+	SScriptArraySTLPoolStats GetStats(asIObjectType *t) const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::map<asIObjectType *, SList>::const_iterator it = m_lists.find(t);
+		if(it != m_lists.end()) return it->second.stats;
+
+		SScriptArraySTLPoolStats stats;
+		memset(&stats, 0, sizeof(stats));
+		return stats;
+	}
+
+	// statistics summed over all array types
+	SScriptArraySTLPoolStats GetStats() const
+	{
+		SScriptArraySTLPoolStats stats;
+		memset(&stats, 0, sizeof(stats));
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for(std::map<asIObjectType *, SList>::const_iterator it = m_lists.begin(); it != m_lists.end(); ++it)
+		{
+			stats.Add(it->second.stats);
+		}
+		return stats;
+	}
+
+private:
+	struct SList
+	{
+		std::vector<CScriptArrayPooled *> arrays;
+		SScriptArraySTLPoolStats          stats;
+
+		SList()
+		{
+			memset(&stats, 0, sizeof(stats));
+		}
+	};
+
+	std::map<asIObjectType *, SList> m_lists;
+	SScriptArraySTLPoolLimits        m_limits;
+	size_t                           m_total_bytes;
+	mutable std::mutex               m_mutex;
+
+	CScriptArraySTLPool()
+		:m_total_bytes(0)
+	{
+	}
+
+	CScriptArraySTLPool(const CScriptArraySTLPool &);
+	CScriptArraySTLPool &operator = (const CScriptArraySTLPool &);
+
+	static void CleanupEngine(asIScriptEngine *engine)
+	{
+		delete (CScriptArraySTLPool *)engine->GetUserData(SCRIPTARRAYSTL_POOL);
+	}
+};
+
+// InitArray() takes arrays from the engine's pool and releasing the last reference puts them back
+template <>
+struct CScriptArraySTL_factory<CScriptArrayPooled>
+{
+	static CScriptArrayPooled *Create(asIObjectType *t, asUINT length)
+	{
+		CScriptArrayPooled *as_array = CScriptArraySTLPool::Get(t->GetEngine()).Acquire(t, length);
+		return as_array != NULL ? as_array : new CScriptArrayPooled(length, t);
+	}
+
+	static void Release(CScriptArrayPooled *as_array)
+	{
+		CScriptArraySTLPool::Get(as_array->GetArrayObjectType()->GetEngine()).Recycle(as_array);
+	}
+};
+
+// pooled arrays keep ordinary heap buffers, only the array objects are recycled
+template <>
+struct CScriptArraySTL_heap_buffer<CScriptArrayPooled>
+{
+	static const bool value = true;
+};
@@ -0,0 +1,115 @@
+// Script arrays with room for a few elements inside the array object.
+// CScriptArraySmall<N> can be used as the TArrayClass of CScriptArraySTL. Its buffer is stored in
+// the array object itself, so it grows up to N elements without reallocating. When it needs more
+// it moves to the heap like any other script array. To scripts it is a normal array<T>.
+// The array is constructed empty and the inline buffer replaces the one CScriptArray made, so the
+// array class never depends on how CScriptArray allocates its first buffer.
+// The inline buffer is sized for elements of up to 8 bytes, which covers every primitive type and
+// handles. Arrays of value types still allocate each element separately.
+// CScriptArraySTLMemory::Install() must have been called before any of this is used.
+//
+// Example:
+//     CScriptArraySTL<float, CScriptArraySmall<8> > position;
+//     position.InitArray(engine, 3);
+// Copyright (c) 2014, Dominque A Douglas
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+//    in the documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+// OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include "ScriptArraySTLMemory.h"
+
+template <size_t N>
+class CScriptArraySmall : public CScriptArray
+{
+public:
+	// bytes needed for the block header, the buffer header and N elements
+	static const size_t storage_size = sizeof(SScriptArraySTLBlock) + offsetof(SArrayBuffer, data) + N * 8;
+
+	CScriptArraySmall(asUINT length, asIObjectType *ot)
+		:CScriptArray(0, ot)
+	{
+		assert(CScriptArraySTLMemory::IsInstalled() && "CScriptArraySTLMemory::Install() must be called first.");
+
+		if(length <= N)
+		{
+			// Replace the empty buffer with the inline one. The block header marks it as owned by
+			// the array, so when CScriptArray moves to a bigger buffer it isn't freed.
+			SArrayBuffer *storage = (SArrayBuffer *)CScriptArraySTLMemory::InitBlock(m_storage, storage_size, CScriptArraySTLOwnedSource::Get());
+			storage->maxElements = (asUINT)N;
+			storage->numElements = 0;
+			DeleteBuffer(buffer);
+			buffer = storage;
+		}
+		CScriptArray::Resize(length);
+	}
+
+	virtual ~CScriptArraySmall()
+	{
+		// the elements in the inline buffer are destroyed while the buffer still exists
+		if(IsInline())
+		{
+			DeleteBuffer(buffer);
+			buffer = NULL;
+		}
+	}
+
+	// allocated like a CScriptArray, since Release() frees it with the array add-on's memory functions
+	static void *operator new(size_t size)
+	{
+		return CScriptArraySTLMemory::AllocArray(size);
+	}
+
+	static void operator delete(void *ptr)
+	{
+		CScriptArraySTLMemory::FreeArray(ptr);
+	}
+
+	// true while the elements are stored inside the array object
+	bool IsInline() const
+	{
+		return buffer != NULL && (const char *)CScriptArraySTLMemory::GetBlock(buffer) == m_storage;
+	}
+
+	// these hide the CScriptArray versions so that moving to the heap leaves room to grow
+	void InsertAt(asUINT index, void *value)
+	{
+		Grow();
+		CScriptArray::InsertAt(index, value);
+	}
+
+	void InsertLast(void *value)
+	{
+		Grow();
+		CScriptArray::InsertLast(value);
+	}
+
+protected:
+	// CScriptArray grows the buffer by exactly one element when inserting into a full array, so
+	// when the inline buffer is full the heap buffer is made twice as big
+	void Grow()
+	{
+		if(buffer->numElements == buffer->maxElements && IsInline())
+		{
+			CScriptArray::Reserve(buffer->maxElements * 2 + 1);
+		}
+	}
+
+private:
+	alignas(16) char m_storage[storage_size];
+
+	CScriptArraySmall(const CScriptArraySmall &);
+	CScriptArraySmall &operator = (const CScriptArraySmall &);
+};
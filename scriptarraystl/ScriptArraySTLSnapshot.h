@@ -0,0 +1,294 @@
+// Consistent snapshots of script arrays for worker threads.
+// Script arrays can only be read on the thread that owns them while scripts may be changing them.
+// CScriptArraySTLSnapshot keeps a few copies of an array. The engine thread copies the array into
+// a copy that no reader is using with publish() and makes it the current version. Worker threads
+// call acquire() to get a view of the current version, which stays unchanged for as long as the
+// view is held even if newer versions are published. Acquiring and releasing a view is lock free.
+// A copy is only reused once every view of it has been released.
+// If the changes since the last publish() are known, passing them as ranges copies only those
+// elements, plus the ranges the reused copy missed while other copies were current.
+// publish() returns false without publishing if every copy is still being read, so there should
+// be at least one more copy than the number of versions that readers hold at the same time.
+//
+// Example:
+//     CScriptArraySTLSnapshot<Vec3> positions;
+//     ... on the engine thread, after the script has run ...
+//     positions.publish(script_positions);
+//     ... on a worker thread ...
+//     CScriptArraySTLSnapshot<Vec3>::view v = positions.acquire();
+//     for(size_t i = 0; i < v.size(); ++i) ... v[i] ...
+// Copyright (c) 2014, Dominque A Douglas
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+//    in the documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+// OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "ScriptArraySTL.h"
+
+// a copy holding more pending ranges than this is copied in full the next time it is used
+#ifndef SCRIPTARRAYSTL_SNAPSHOT_MAX_RANGES
+#define SCRIPTARRAYSTL_SNAPSHOT_MAX_RANGES 64
+#endif
+
+// Snapshot statistics
+struct SScriptArraySTLSnapshotStats
+{
+	size_t published;       // calls to publish() that made a new version
+	size_t skipped;         // calls to publish() that failed because every copy was being read
+	size_t full_copies;     // versions that were made by copying the whole array
+	size_t elements_copied; // elements copied by publish()
+};
+
+template <class T>
+class CScriptArraySTLSnapshot
+{
+	struct SBuffer;
+
+public:
+	// A read only view of one version. The version can't be reused while the view exists.
+	class view
+	{
+	public:
+		typedef typename std::vector<T>::const_iterator const_iterator;
+
+		view()
+			:m_buffer(NULL)
+		{
+		}
+
+		view(view &&other)
+			:m_buffer(other.m_buffer)
+		{
+			other.m_buffer = NULL;
+		}
+
+		view &operator = (view &&other)
+		{
+			if(this != &other)
+			{
+				reset();
+				m_buffer = other.m_buffer;
+				other.m_buffer = NULL;
+			}
+			return *this;
+		}
+
+		~view()
+		{
+			reset();
+		}
+
+		// releases the version early
+		void reset()
+		{
+			if(m_buffer != NULL) m_buffer->readers.fetch_sub(1, std::memory_order_release);
+			m_buffer = NULL;
+		}
+
+		// the number of the version. The first version published is 1.
+		size_t version() const { return m_buffer->version; }
+
+		size_t size() const { return m_buffer->data.size(); }
+		bool empty() const { return m_buffer->data.empty(); }
+		const T &operator[](size_t index) const { return m_buffer->data[index]; }
+		const T *data() const { return m_buffer->data.data(); }
+		const_iterator begin() const { return m_buffer->data.begin(); }
+		const_iterator end() const { return m_buffer->data.end(); }
+
+	private:
+		friend class CScriptArraySTLSnapshot;
+
+		SBuffer *m_buffer;
+
+		explicit view(SBuffer *buffer)
+			:m_buffer(buffer)
+		{
+		}
+
+		view(const view &);
+		view &operator = (const view &);
+	};
+
+	// copies is the number of copies of the array that are kept. At least 2 are needed.
+	explicit CScriptArraySTLSnapshot(size_t copies = 3)
+		:m_buffers(new SBuffer[copies < 2 ? 2 : copies]), m_count(copies < 2 ? 2 : copies), m_current(0), m_version(0)
+	{
+		memset(&m_stats, 0, sizeof(m_stats));
+	}
+
+	~CScriptArraySTLSnapshot()
+	{
+		for(size_t i = 0; i < m_count; ++i)
+		{
+			assert((m_buffers[i].readers.load() == 0) && "Snapshot destroyed while views still use it.");
+		}
+	}
+
+	// Copies the whole array into a copy that isn't being read and makes it the current version.
+	// Only call this from the thread that owns the array.
+	template <class A>
+	bool publish(const CScriptArraySTL<T, A> &a)
+	{
+		return publish(a, (const SScriptArraySTLRange *)NULL, (const SScriptArraySTLRange *)NULL, true);
+	}
+
+	// Publishes a new version when only the elements in the ranges [first, last) have changed since
+	// the last publish(). If the size of the array changed the whole array is copied.
+	template <class A, class RangeIterator>
+	bool publish(const CScriptArraySTL<T, A> &a, RangeIterator first, RangeIterator last)
+	{
+		return publish(a, first, last, false);
+	}
+
+	// returns a view of the current version. Can be called from any thread.
+	view acquire() const
+	{
+		for(;;)
+		{
+			SBuffer *buffer = &m_buffers[m_current.load()];
+			buffer->readers.fetch_add(1);
+
+			// if the version changed in between, the copy could be in the middle of being reused
+			if(buffer == &m_buffers[m_current.load()]) return view(buffer);
+
+			buffer->readers.fetch_sub(1, std::memory_order_release);
+		}
+	}
+
+	// the number of the current version, 0 before anything is published. Only call this from the
+	// thread that calls publish(). Readers get the version from their view.
+	size_t version() const
+	{
+		return m_version;
+	}
+
+	// only call this from the thread that calls publish()
+	const SScriptArraySTLSnapshotStats &GetStats() const
+	{
+		return m_stats;
+	}
+
+private:
+	struct SBuffer
+	{
+		std::vector<T>                    data;
+		size_t                            version;
+		mutable std::atomic<int>          readers;
+		std::vector<SScriptArraySTLRange> pending; // ranges changed since this copy was made
+		bool                              full;    // the whole array has to be copied
+
+		SBuffer()
+			:version(0), readers(0), full(true)
+		{
+		}
+	};
+
+	std::unique_ptr<SBuffer[]>   m_buffers;
+	size_t                       m_count;
+	std::atomic<size_t>          m_current;
+	size_t                       m_version;
+	SScriptArraySTLSnapshotStats m_stats;
+
+	template <class A, class RangeIterator>
+	bool publish(const CScriptArraySTL<T, A> &a, RangeIterator first, RangeIterator last, bool full)
+	{
+		// reuse the newest copy that isn't current and that nobody is reading
+		size_t current = m_current.load();
+		SBuffer *target = NULL;
+		for(size_t i = 0; i < m_count; ++i)
+		{
+			SBuffer &buffer = m_buffers[i];
+			if(i != current && buffer.readers.load() == 0 && (target == NULL || buffer.version > target->version))
+			{
+				target = &buffer;
+			}
+		}
+		if(target == NULL)
+		{
+			m_stats.skipped++;
+
+			// the changes still have to reach every copy later
+			for(size_t i = 0; i < m_count; ++i)
+			{
+				if(full) m_buffers[i].full = true;
+				else AddPending(m_buffers[i], first, last);
+			}
+			return false;
+		}
+
+		// the other copies will need these ranges when they are reused
+		for(size_t i = 0; i < m_count; ++i)
+		{
+			if(&m_buffers[i] == target) continue;
+			if(full) m_buffers[i].full = true;
+			else AddPending(m_buffers[i], first, last);
+		}
+
+		// the new ranges can push the copy over the limit, so they are added before deciding
+		if(full) target->full = true;
+		else AddPending(*target, first, last);
+
+		if(target->full || target->data.size() != a.size())
+		{
+			target->data.assign(a.begin(), a.end());
+			m_stats.full_copies++;
+			m_stats.elements_copied += a.size();
+		}
+		else
+		{
+			for(size_t i = 0; i < target->pending.size(); ++i)
+			{
+				size_t begin = std::min(target->pending[i].first, a.size());
+				size_t end = std::min(target->pending[i].last, a.size());
+				if(begin >= end) continue;
+
+				std::copy(a.begin() + begin, a.begin() + end, target->data.begin() + begin);
+				m_stats.elements_copied += end - begin;
+			}
+		}
+		target->pending.clear();
+		target->full = false;
+		target->version = ++m_version;
+
+		m_current.store((size_t)(target - &m_buffers[0]));
+		m_stats.published++;
+		return true;
+	}
+
+	template <class RangeIterator>
+	static void AddPending(SBuffer &buffer, RangeIterator first, RangeIterator last)
+	{
+		if(buffer.full) return;
+
+		for(; first != last; ++first)
+		{
+			if(buffer.pending.size() >= SCRIPTARRAYSTL_SNAPSHOT_MAX_RANGES)
+			{
+				buffer.full = true;
+				buffer.pending.clear();
+				return;
+			}
+			buffer.pending.push_back(*first);
+		}
+	}
+
+	CScriptArraySTLSnapshot(const CScriptArraySTLSnapshot &);
+	CScriptArraySTLSnapshot &operator = (const CScriptArraySTLSnapshot &);
+};
@@ -0,0 +1,549 @@
+// Struct-of-arrays storage for arrays of registered value types.
+// A CScriptArraySTL<Particle> keeps every Particle as one object, so a loop that only reads the
+// positions still pulls the whole struct through the cache. CScriptArraySTLSoA keeps each field
+// that is listed for it in its own std::vector instead. column<I>() returns a pointer to the
+// contiguous values of field I, so loops over a single field read dense memory and can be
+// vectorized by the compiler.
+// Elements can still be used whole. operator[] returns a proxy that converts to T and can be
+// assigned a T, and get(i)/set(i, value) gather and scatter an element. The iterators are random
+// access and dereference to the same proxies, so std::sort and the other standard algorithms can
+// be used on the container. Only the listed fields are stored. Fields that aren't listed are
+// default constructed when an element is gathered and dropped when it is scattered, so every field
+// that matters should be listed. T must be default constructible.
+// assign() and copy_to() convert from and to a normal CScriptArraySTL<T>.
+//
+// RegisterScriptArraySTLSoA() registers a container type as a script type so scripts can use it
+// much like an array<T>:
+//     uint length() const
+//     void resize(uint)
+//     void insertLast(const T &in)
+//     void removeLast()
+//     T opIndex                       (indexed property, soa[i] and soa[i] = value)
+//     F <field name>                  (indexed property per field, soa.pos[i])
+// Elements are returned by value, so soa[i].pos = value doesn't change the container. Use
+// soa.pos[i] = value instead. The script type is a reference type without reference counting,
+// so the C++ side owns the container and would usually register it as a global property.
+//
+// Example:
+//     struct Particle { Vec3 pos; Vec3 vel; float life; };
+//     typedef CScriptArraySTLSoA<Particle,
+//         SCRIPTARRAYSTL_SOA_FIELD(Particle, pos),
+//         SCRIPTARRAYSTL_SOA_FIELD(Particle, vel),
+//         SCRIPTARRAYSTL_SOA_FIELD(Particle, life)> ParticleSoA;
+//
+//     static const char *const particle_fields[] = { "pos", "vel", "life" };
+//     RegisterScriptArraySTLSoA<ParticleSoA>(engine, "particles_t", particle_fields);
+//     engine->RegisterGlobalProperty("particles_t particles", &particles);
+//
+//     float *life = particles.column<2>();
+//     for(size_t i = 0; i < particles.size(); ++i) life[i] -= dt;
+// Copyright (c) 2014, Dominque A Douglas
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+//    in the documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+// OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <stddef.h>
+#include <iterator>
+#include <new>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "ScriptArraySTL.h"
+
+// Describes one field of T that is stored in its own column
+template <class T, class F, F T::*Member>
+struct CScriptArraySTLSoAField
+{
+	typedef F type;
+
+	static F &get(T &value)             { return value.*Member; }
+	static const F &get(const T &value) { return value.*Member; }
+};
+
+#define SCRIPTARRAYSTL_SOA_FIELD(T, name) CScriptArraySTLSoAField<T, decltype(((T *)0)->name), &T::name>
+
+template <class T, class... Fields>
+class CScriptArraySTLSoA
+{
+public:
+	typedef T      value_type;
+	typedef size_t size_type;
+
+	static const size_t field_count = sizeof...(Fields);
+
+	// field<I>::type is the C++ type of field I
+	template <size_t I>
+	struct field
+	{
+		typedef typename std::tuple_element<I, std::tuple<Fields...> >::type descriptor;
+		typedef typename descriptor::type type;
+	};
+
+	// Stands for element i of a container. It converts to a T and assigning a T to it
+	// scatters the value into the columns.
+	class reference
+	{
+	public:
+		operator T () const
+		{
+			return m_soa->get(m_index);
+		}
+
+		reference &operator = (const T &value)
+		{
+			m_soa->set(m_index, value);
+			return *this;
+		}
+
+		reference &operator = (const reference &other)
+		{
+			m_soa->set(m_index, other.m_soa->get(other.m_index));
+			return *this;
+		}
+
+		// field I of this element
+		template <size_t I>
+		typename field<I>::type &get() const
+		{
+			return m_soa->template column<I>()[m_index];
+		}
+
+		// swaps the elements, not the references, one column at a time
+		friend void swap(reference a, reference b)
+		{
+			a.m_soa->swap_elements(a.m_index, b.m_index);
+		}
+
+	private:
+		friend class CScriptArraySTLSoA;
+
+		reference(CScriptArraySTLSoA *soa, size_t index) : m_soa(soa), m_index(index) {}
+
+		CScriptArraySTLSoA *m_soa;
+		size_t              m_index;
+	};
+
+	// Random access iterators over the elements. Dereferencing an iterator gives a reference and
+	// dereferencing a const_iterator gives a copy of the element, so algorithms like std::sort
+	// work on the container the same way they do on std::vector<bool>.
+	template <bool is_const>
+	class basic_iterator
+	{
+		typedef typename std::conditional<is_const, const CScriptArraySTLSoA, CScriptArraySTLSoA>::type container;
+
+	public:
+		typedef std::random_access_iterator_tag iterator_category;
+		typedef T         value_type;
+		typedef ptrdiff_t difference_type;
+		typedef typename std::conditional<is_const, T, typename CScriptArraySTLSoA::reference>::type reference;
+		typedef void      pointer;
+
+		basic_iterator() : m_soa(NULL), m_index(0) {}
+
+		// an iterator converts to a const_iterator
+		basic_iterator(const basic_iterator<false> &other) : m_soa(other.m_soa), m_index(other.m_index) {}
+
+		reference operator * () const { return (*m_soa)[m_index]; }
+		reference operator [] (difference_type n) const { return (*m_soa)[m_index + n]; }
+
+		basic_iterator &operator ++ () { ++m_index; return *this; }
+		basic_iterator &operator -- () { --m_index; return *this; }
+		basic_iterator operator ++ (int) { basic_iterator t(*this); ++m_index; return t; }
+		basic_iterator operator -- (int) { basic_iterator t(*this); --m_index; return t; }
+		basic_iterator &operator += (difference_type n) { m_index += n; return *this; }
+		basic_iterator &operator -= (difference_type n) { m_index -= n; return *this; }
+		basic_iterator operator + (difference_type n) const { return basic_iterator(m_soa, m_index + n); }
+		basic_iterator operator - (difference_type n) const { return basic_iterator(m_soa, m_index - n); }
+		friend basic_iterator operator + (difference_type n, const basic_iterator &it) { return it + n; }
+		difference_type operator - (const basic_iterator &other) const { return (difference_type)m_index - (difference_type)other.m_index; }
+
+		bool operator == (const basic_iterator &other) const { return m_index == other.m_index; }
+		bool operator != (const basic_iterator &other) const { return m_index != other.m_index; }
+		bool operator < (const basic_iterator &other) const  { return m_index < other.m_index; }
+		bool operator > (const basic_iterator &other) const  { return m_index > other.m_index; }
+		bool operator <= (const basic_iterator &other) const { return m_index <= other.m_index; }
+		bool operator >= (const basic_iterator &other) const { return m_index >= other.m_index; }
+
+	private:
+		friend class CScriptArraySTLSoA;
+		friend class basic_iterator<true>;
+
+		basic_iterator(container *soa, size_t index) : m_soa(soa), m_index(index) {}
+
+		container *m_soa;
+		size_t     m_index;
+	};
+
+	typedef basic_iterator<false> iterator;
+	typedef basic_iterator<true>  const_iterator;
+
+	CScriptArraySTLSoA()
+		:m_size(0)
+	{
+	}
+
+	// converts an array of structs
+	template <class A>
+	explicit CScriptArraySTLSoA(const CScriptArraySTL<T, A> &a)
+		:m_size(0)
+	{
+		assign(a);
+	}
+
+	// ----------------------------------------------------------------------------------
+	// Conversion
+	// ----------------------------------------------------------------------------------
+
+	// replaces the contents with the elements of a
+	template <class A>
+	void assign(const CScriptArraySTL<T, A> &a)
+	{
+		size_t count = a.size();
+		each<0>::resize(m_columns, count);
+		m_size = count;
+
+		// value types are kept as separate objects in a script array, so each one is read once
+		for(size_t i = 0; i < count; ++i) each<0>::scatter(m_columns, i, a[i]);
+	}
+
+	// resizes a to size() and copies the elements into it. Fields that aren't stored keep
+	// the values they had in a.
+	template <class A>
+	void copy_to(CScriptArraySTL<T, A> &a) const
+	{
+		a.resize(m_size);
+		for(size_t i = 0; i < m_size; ++i) each<0>::gather(m_columns, i, a[i]);
+	}
+
+	// ----------------------------------------------------------------------------------
+	// Columns
+	// ----------------------------------------------------------------------------------
+
+	// the size() values of field I, one after the other
+	template <size_t I>
+	typename field<I>::type *column()
+	{
+		return std::get<I>(m_columns).data();
+	}
+
+	template <size_t I>
+	const typename field<I>::type *column() const
+	{
+		return std::get<I>(m_columns).data();
+	}
+
+	// ----------------------------------------------------------------------------------
+	// Elements
+	// ----------------------------------------------------------------------------------
+
+	size_type size() const
+	{
+		return m_size;
+	}
+
+	bool empty() const
+	{
+		return m_size == 0;
+	}
+
+	// gathers element i from the columns
+	T get(size_type i) const
+	{
+		T value = T();
+		each<0>::gather(m_columns, i, value);
+		return value;
+	}
+
+	// scatters value into the columns at i
+	void set(size_type i, const T &value)
+	{
+		each<0>::scatter(m_columns, i, value);
+	}
+
+	reference operator [] (size_type i)
+	{
+		return reference(this, i);
+	}
+
+	T operator [] (size_type i) const
+	{
+		return get(i);
+	}
+
+	iterator begin()
+	{
+		return iterator(this, 0);
+	}
+
+	iterator end()
+	{
+		return iterator(this, m_size);
+	}
+
+	const_iterator begin() const
+	{
+		return const_iterator(this, 0);
+	}
+
+	const_iterator end() const
+	{
+		return const_iterator(this, m_size);
+	}
+
+	// exchanges elements i and j field by field
+	void swap_elements(size_type i, size_type j)
+	{
+		each<0>::swap(m_columns, i, j);
+	}
+
+	void push_back(const T &value)
+	{
+		each<0>::push_back(m_columns, value);
+		++m_size;
+	}
+
+	void pop_back()
+	{
+		each<0>::pop_back(m_columns);
+		--m_size;
+	}
+
+	// new elements get the fields of a default constructed T
+	void resize(size_type n)
+	{
+		resize(n, T());
+	}
+
+	void resize(size_type n, const T &value)
+	{
+		each<0>::resize(m_columns, n, value);
+		m_size = n;
+	}
+
+	void reserve(size_type n)
+	{
+		each<0>::reserve(m_columns, n);
+	}
+
+	void clear()
+	{
+		resize(0);
+	}
+
+private:
+	typedef std::tuple<std::vector<typename Fields::type>...> columns_type;
+
+	// applies an operation to every column, starting with column I
+	template <size_t I, bool End = (I == field_count)>
+	struct each
+	{
+		typedef typename field<I>::descriptor descriptor;
+		typedef each<I + 1> next;
+
+		static void scatter(columns_type &c, size_t i, const T &value)
+		{
+			std::get<I>(c)[i] = descriptor::get(value);
+			next::scatter(c, i, value);
+		}
+
+		static void gather(const columns_type &c, size_t i, T &value)
+		{
+			descriptor::get(value) = std::get<I>(c)[i];
+			next::gather(c, i, value);
+		}
+
+		static void push_back(columns_type &c, const T &value)
+		{
+			std::get<I>(c).push_back(descriptor::get(value));
+			next::push_back(c, value);
+		}
+
+		static void pop_back(columns_type &c)
+		{
+			std::get<I>(c).pop_back();
+			next::pop_back(c);
+		}
+
+		static void resize(columns_type &c, size_t n)
+		{
+			std::get<I>(c).resize(n);
+			next::resize(c, n);
+		}
+
+		static void resize(columns_type &c, size_t n, const T &value)
+		{
+			std::get<I>(c).resize(n, descriptor::get(value));
+			next::resize(c, n, value);
+		}
+
+		static void reserve(columns_type &c, size_t n)
+		{
+			std::get<I>(c).reserve(n);
+			next::reserve(c, n);
+		}
+
+		static void swap(columns_type &c, size_t i, size_t j)
+		{
+			using std::swap;
+			swap(std::get<I>(c)[i], std::get<I>(c)[j]);
+			next::swap(c, i, j);
+		}
+	};
+
+	template <size_t I>
+	struct each<I, true>
+	{
+		static void scatter(columns_type &, size_t, const T &) {}
+		static void gather(const columns_type &, size_t, T &) {}
+		static void push_back(columns_type &, const T &) {}
+		static void pop_back(columns_type &) {}
+		static void resize(columns_type &, size_t) {}
+		static void resize(columns_type &, size_t, const T &) {}
+		static void reserve(columns_type &, size_t) {}
+		static void swap(columns_type &, size_t, size_t) {}
+	};
+
+	columns_type m_columns;
+	size_t       m_size;
+};
+
+template <class SoA>
+struct CScriptArraySTL_soa_binding
+{
+	typedef typename SoA::value_type T;
+
+	static void SetException(const char *message)
+	{
+		asIScriptContext *ctx = asGetActiveContext();
+		if(ctx) ctx->SetException(message);
+	}
+
+	static bool CheckIndex(SoA *self, asUINT index)
+	{
+		if(index < self->size()) return true;
+		SetException("Index out of bounds");
+		return false;
+	}
+
+	static void Length(asIScriptGeneric *gen)
+	{
+		gen->SetReturnDWord((asDWORD)((SoA *)gen->GetObject())->size());
+	}
+
+	static void Resize(asIScriptGeneric *gen)
+	{
+		((SoA *)gen->GetObject())->resize(gen->GetArgDWord(0));
+	}
+
+	static void InsertLast(asIScriptGeneric *gen)
+	{
+		((SoA *)gen->GetObject())->push_back(*(const T *)gen->GetArgAddress(0));
+	}
+
+	static void RemoveLast(asIScriptGeneric *gen)
+	{
+		SoA *self = (SoA *)gen->GetObject();
+		if(self->empty()) { SetException("Index out of bounds"); return; }
+		self->pop_back();
+	}
+
+	static void GetElement(asIScriptGeneric *gen)
+	{
+		SoA *self = (SoA *)gen->GetObject();
+		asUINT index = gen->GetArgDWord(0);
+		if(!CheckIndex(self, index)) return;
+		new(gen->GetAddressOfReturnLocation()) T(self->get(index));
+	}
+
+	static void SetElement(asIScriptGeneric *gen)
+	{
+		SoA *self = (SoA *)gen->GetObject();
+		asUINT index = gen->GetArgDWord(0);
+		if(!CheckIndex(self, index)) return;
+		self->set(index, *(const T *)gen->GetArgAddress(1));
+	}
+
+	template <size_t I>
+	static void GetField(asIScriptGeneric *gen)
+	{
+		typedef typename SoA::template field<I>::type F;
+
+		SoA *self = (SoA *)gen->GetObject();
+		asUINT index = gen->GetArgDWord(0);
+		if(!CheckIndex(self, index)) return;
+		new(gen->GetAddressOfReturnLocation()) F(self->template column<I>()[index]);
+	}
+
+	template <size_t I>
+	static void SetField(asIScriptGeneric *gen)
+	{
+		typedef typename SoA::template field<I>::type F;
+
+		SoA *self = (SoA *)gen->GetObject();
+		asUINT index = gen->GetArgDWord(0);
+		if(!CheckIndex(self, index)) return;
+		self->template column<I>()[index] = *(const F *)gen->GetArgAddress(1);
+	}
+
+	// registers the indexed property accessors of field I and the ones after it
+	template <size_t I, bool End = (I == SoA::field_count)>
+	struct RegisterFields
+	{
+		static int Run(asIScriptEngine *engine, const char *type_name, const char *const *field_names)
+		{
+			std::string decl = CScriptArraySTL_type<typename SoA::template field<I>::type>::decl();
+			int r;
+
+			r = engine->RegisterObjectMethod(type_name, (decl + " get_" + field_names[I] + "(uint) const").c_str(), asFUNCTION(GetField<I>), asCALL_GENERIC); if(r < 0) return r;
+			r = engine->RegisterObjectMethod(type_name, ("void set_" + std::string(field_names[I]) + "(uint, const " + decl + " &in)").c_str(), asFUNCTION(SetField<I>), asCALL_GENERIC); if(r < 0) return r;
+
+			return RegisterFields<I + 1>::Run(engine, type_name, field_names);
+		}
+	};
+
+	template <size_t I>
+	struct RegisterFields<I, true>
+	{
+		static int Run(asIScriptEngine *, const char *, const char *const *)
+		{
+			return 0;
+		}
+	};
+};
+
+// Registers SoA as the script type type_name. field_names holds the script name of each field
+// in the order they were given to CScriptArraySTLSoA. The element type and the field types must
+// already be registered and have CScriptArraySTL_type specializations.
+template <class SoA>
+int RegisterScriptArraySTLSoA(asIScriptEngine *engine, const char *type_name, const char *const *field_names)
+{
+	typedef CScriptArraySTL_soa_binding<SoA> B;
+	std::string element = CScriptArraySTL_type<typename SoA::value_type>::decl();
+	int r;
+
+	r = engine->RegisterObjectType(type_name, 0, asOBJ_REF | asOBJ_NOCOUNT); if(r < 0) return r;
+	r = engine->RegisterObjectMethod(type_name, "uint length() const", asFUNCTION(B::Length), asCALL_GENERIC); if(r < 0) return r;
+	r = engine->RegisterObjectMethod(type_name, "void resize(uint)", asFUNCTION(B::Resize), asCALL_GENERIC); if(r < 0) return r;
+	r = engine->RegisterObjectMethod(type_name, ("void insertLast(const " + element + " &in)").c_str(), asFUNCTION(B::InsertLast), asCALL_GENERIC); if(r < 0) return r;
+	r = engine->RegisterObjectMethod(type_name, "void removeLast()", asFUNCTION(B::RemoveLast), asCALL_GENERIC); if(r < 0) return r;
+	r = engine->RegisterObjectMethod(type_name, (element + " get_opIndex(uint) const").c_str(), asFUNCTION(B::GetElement), asCALL_GENERIC); if(r < 0) return r;
+	r = engine->RegisterObjectMethod(type_name, ("void set_opIndex(uint, const " + element + " &in)").c_str(), asFUNCTION(B::SetElement), asCALL_GENERIC); if(r < 0) return r;
+
+	return B::template RegisterFields<0>::Run(engine, type_name, field_names);
+}
@@ -0,0 +1,192 @@
+// Instrumentation counters for CScriptArraySTL.
+// Define SCRIPTARRAYSTL_INSTRUMENT before including ScriptArraySTL.h (or in the project settings)
+// to count how arrays are used through CScriptArraySTL. Without it nothing here is compiled in
+// and CScriptArraySTL has no extra members or work.
+// Counters are kept for each CScriptArraySTL object (GetStats() and ResetStats()) and are also
+// added up for each array type, ie every array<int> together. CScriptArraySTLStats::Snapshot()
+// returns the per-type totals, Reset() clears them and Dump() prints them with the arrays that
+// copied the most bytes first. Many reallocations compared to growth events, or a lot of
+// element accesses, point to arrays that should be reserved up front or use the bulk operations.
+// Only work done through CScriptArraySTL is counted. Elements read or written through iterators
+// and data() pointers of contiguous types, and changes made by scripts, aren't seen.
+// Copyright (c) 2014, Dominque A Douglas
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+//    in the documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+// OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <stdio.h>
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../scriptarray/scriptarray.h"
+
+struct SScriptArraySTLStats
+{
+	unsigned long long element_accesses; // operator[], at(), front() and back()
+	unsigned long long reallocations;    // times the elements were moved to a new buffer
+	unsigned long long bytes_copied;     // bytes moved by reallocations plus sizeof(T) for each element copied in
+	unsigned long long growth_events;    // operations that made the array bigger
+	unsigned long long peak_capacity;    // largest capacity seen, in elements
+
+	SScriptArraySTLStats()
+		:element_accesses(0), reallocations(0), bytes_copied(0), growth_events(0), peak_capacity(0)
+	{
+	}
+
+	void Add(const SScriptArraySTLStats &other)
+	{
+		element_accesses += other.element_accesses;
+		reallocations += other.reallocations;
+		bytes_copied += other.bytes_copied;
+		growth_events += other.growth_events;
+		peak_capacity = std::max(peak_capacity, other.peak_capacity);
+	}
+};
+
+// The totals for one array type. Arrays on different threads add to the same totals, so the
+// counters are atomic. Relaxed ordering is enough since they are only ever added up.
+struct SScriptArraySTLTypeStats
+{
+	std::atomic<unsigned long long> element_accesses;
+	std::atomic<unsigned long long> reallocations;
+	std::atomic<unsigned long long> bytes_copied;
+	std::atomic<unsigned long long> growth_events;
+	std::atomic<unsigned long long> peak_capacity;
+
+	SScriptArraySTLTypeStats()
+		:element_accesses(0), reallocations(0), bytes_copied(0), growth_events(0), peak_capacity(0)
+	{
+	}
+
+	void Add(const SScriptArraySTLStats &delta)
+	{
+		if(delta.element_accesses) element_accesses.fetch_add(delta.element_accesses, std::memory_order_relaxed);
+		if(delta.reallocations) reallocations.fetch_add(delta.reallocations, std::memory_order_relaxed);
+		if(delta.bytes_copied) bytes_copied.fetch_add(delta.bytes_copied, std::memory_order_relaxed);
+		if(delta.growth_events) growth_events.fetch_add(delta.growth_events, std::memory_order_relaxed);
+
+		unsigned long long peak = peak_capacity.load(std::memory_order_relaxed);
+		while(delta.peak_capacity > peak && !peak_capacity.compare_exchange_weak(peak, delta.peak_capacity, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	SScriptArraySTLStats Load() const
+	{
+		SScriptArraySTLStats stats;
+		stats.element_accesses = element_accesses.load(std::memory_order_relaxed);
+		stats.reallocations = reallocations.load(std::memory_order_relaxed);
+		stats.bytes_copied = bytes_copied.load(std::memory_order_relaxed);
+		stats.growth_events = growth_events.load(std::memory_order_relaxed);
+		stats.peak_capacity = peak_capacity.load(std::memory_order_relaxed);
+		return stats;
+	}
+
+	void Clear()
+	{
+		element_accesses.store(0, std::memory_order_relaxed);
+		reallocations.store(0, std::memory_order_relaxed);
+		bytes_copied.store(0, std::memory_order_relaxed);
+		growth_events.store(0, std::memory_order_relaxed);
+		peak_capacity.store(0, std::memory_order_relaxed);
+	}
+};
+
+// Registry of the per-type totals. Types are keyed by their declaration (ie "array<int>"), so
+// arrays of the same type from different engines share one entry.
+class CScriptArraySTLStats
+{
+public:
+	typedef std::vector<std::pair<std::string, SScriptArraySTLStats> > snapshot_type;
+
+	// returns the totals for an array type, creating them on first use. The pointer stays valid
+	// for the life of the program.
+	static SScriptArraySTLTypeStats *ForType(asIObjectType *t)
+	{
+		const char *decl = t->GetEngine()->GetTypeDeclaration(t->GetTypeId());
+		std::string name(decl ? decl : t->GetName());
+
+		Registry &registry = GetRegistry();
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		std::unique_ptr<SScriptArraySTLTypeStats> &stats = registry.types[name];
+		if(!stats) stats.reset(new SScriptArraySTLTypeStats());
+		return stats.get();
+	}
+
+	// returns a copy of the totals for every array type that has been used, sorted by name
+	static snapshot_type Snapshot()
+	{
+		Registry &registry = GetRegistry();
+		std::lock_guard<std::mutex> lock(registry.mutex);
+
+		snapshot_type snapshot;
+		for(std::map<std::string, std::unique_ptr<SScriptArraySTLTypeStats> >::const_iterator it = registry.types.begin(); it != registry.types.end(); ++it)
+		{
+			snapshot.push_back(std::make_pair(it->first, it->second->Load()));
+		}
+		return snapshot;
+	}
+
+	// sets every per-type total back to zero
+	static void Reset()
+	{
+		Registry &registry = GetRegistry();
+		std::lock_guard<std::mutex> lock(registry.mutex);
+		for(std::map<std::string, std::unique_ptr<SScriptArraySTLTypeStats> >::iterator it = registry.types.begin(); it != registry.types.end(); ++it)
+		{
+			it->second->Clear();
+		}
+	}
+
+	// prints the per-type totals, the types that copied the most bytes first
+	static void Dump(FILE *out = stdout)
+	{
+		snapshot_type snapshot = Snapshot();
+		std::stable_sort(snapshot.begin(), snapshot.end(), MoreBytesCopied);
+
+		fprintf(out, "%-32s %16s %12s %16s %12s %14s\n", "array type", "accesses", "reallocs", "bytes copied", "growths", "peak capacity");
+		for(size_t i = 0; i < snapshot.size(); ++i)
+		{
+			const SScriptArraySTLStats &s = snapshot[i].second;
+			fprintf(out, "%-32s %16llu %12llu %16llu %12llu %14llu\n", snapshot[i].first.c_str(),
+				s.element_accesses, s.reallocations, s.bytes_copied, s.growth_events, s.peak_capacity);
+		}
+	}
+
+private:
+	struct Registry
+	{
+		std::mutex mutex;
+		std::map<std::string, std::unique_ptr<SScriptArraySTLTypeStats> > types;
+	};
+
+	static Registry &GetRegistry()
+	{
+		static Registry registry;
+		return registry;
+	}
+
+	static bool MoreBytesCopied(const snapshot_type::value_type &a, const snapshot_type::value_type &b)
+	{
+		return a.second.bytes_copied > b.second.bytes_copied;
+	}
+};
@@ -0,0 +1,318 @@
+// Binary snapshots of script arrays.
+// save_array() writes a CScriptArraySTL to a std::ostream and load_array() replaces the contents of
+// an initialized CScriptArraySTL with what it reads from a std::istream. The snapshot starts with a
+// header holding the script declaration of the array type, the element size, the element count and
+// the byte order, and load_array() refuses snapshots of a different type. Snapshots written on a
+// machine with the other byte order are converted while loading when the elements are numbers.
+// Elements of primitive types are written and read as blocks of memory, strings as a length
+// followed by the characters, and other trivially copyable types a copy of each element at a time.
+// Data goes through the stream in pieces of at most SCRIPTARRAYSTL_STREAM_CHUNK_BYTES.
+// Arrays of handles can't be saved.
+//
+// Both return 0 on success, -1 if the stream failed, -2 if the data isn't a snapshot and -3 if it is
+// a snapshot of a different array type.
+// Copyright (c) 2014, Dominque A Douglas
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+//    in the documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+// OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <string.h>
+#include <algorithm>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "ScriptArraySTL.h"
+
+#ifndef SCRIPTARRAYSTL_STREAM_CHUNK_BYTES
+#define SCRIPTARRAYSTL_STREAM_CHUNK_BYTES 65536
+#endif
+
+// Version of the snapshot header. Snapshots with a different version are rejected.
+#define SCRIPTARRAYSTL_STREAM_VERSION 1
+
+// The header at the start of a snapshot. It is followed by decl_length characters of the array
+// type's declaration and then the elements.
+struct SScriptArraySTLStreamHeader
+{
+	char    magic[4];     // "ASAR"
+	asDWORD byte_order;   // 0x01020304 in the byte order of the machine that wrote the snapshot
+	asWORD  version;      // SCRIPTARRAYSTL_STREAM_VERSION
+	asWORD  decl_length;  // length of the declaration
+	asDWORD element_size; // sizeof(T)
+	asQWORD count;        // number of elements
+};
+
+// How the elements of T are written
+template <class T>
+struct CScriptArraySTL_stream_traits
+{
+	// elements are laid out in the array's buffer and written as one block
+	static const bool block = CScriptArraySTL_is_contiguous<T>::value && !std::is_pointer<T>::value;
+
+	// elements are objects that are copied one at a time through a chunk buffer
+	static const bool copied = !block && !std::is_pointer<T>::value && std::is_trivially_copyable<T>::value;
+};
+
+// Reverses the byte order of count elements of size bytes each
+inline void ScriptArraySTL_SwapBytes(void *data, size_t size, size_t count)
+{
+	unsigned char *p = (unsigned char *)data;
+	for(size_t i = 0; i < count; ++i, p += size)
+	{
+		std::reverse(p, p + size);
+	}
+}
+
+// writes the header followed by the declaration
+template <class T, class A>
+int ScriptArraySTL_WriteHeader(std::ostream &os, const CScriptArraySTL<T, A> &a)
+{
+	CScriptArray *as_array = const_cast<CScriptArraySTL<T, A> &>(a).GetRef();
+	const char *decl = as_array->GetArrayObjectType()->GetEngine()->GetTypeDeclaration(as_array->GetArrayTypeId());
+	size_t decl_length = decl ? strlen(decl) : 0;
+	if(decl_length == 0 || decl_length > 0xFFFF) return -3;
+
+	SScriptArraySTLStreamHeader header;
+	memcpy(header.magic, "ASAR", 4);
+	header.byte_order = 0x01020304;
+	header.version = SCRIPTARRAYSTL_STREAM_VERSION;
+	header.decl_length = (asWORD)decl_length;
+	header.element_size = (asDWORD)sizeof(T);
+	header.count = a.size();
+
+	os.write((const char *)&header, sizeof(header));
+	os.write(decl, (std::streamsize)decl_length);
+	return os ? 0 : -1;
+}
+
+// Reads and checks the header. swap is set if the snapshot has the other byte order.
+template <class T, class A>
+int ScriptArraySTL_ReadHeader(std::istream &is, CScriptArraySTL<T, A> &a, asQWORD &count, bool &swap)
+{
+	SScriptArraySTLStreamHeader header;
+	if(!is.read((char *)&header, sizeof(header))) return -1;
+
+	swap = header.byte_order == 0x04030201;
+	if(memcmp(header.magic, "ASAR", 4) != 0 || (header.byte_order != 0x01020304 && !swap)) return -2;
+	if(swap)
+	{
+		ScriptArraySTL_SwapBytes(&header.version, sizeof(header.version), 1);
+		ScriptArraySTL_SwapBytes(&header.decl_length, sizeof(header.decl_length), 1);
+		ScriptArraySTL_SwapBytes(&header.element_size, sizeof(header.element_size), 1);
+		ScriptArraySTL_SwapBytes(&header.count, sizeof(header.count), 1);
+	}
+	if(header.version != SCRIPTARRAYSTL_STREAM_VERSION) return -2;
+
+	std::string decl(header.decl_length, '\0');
+	if(header.decl_length > 0 && !is.read(&decl[0], header.decl_length)) return -1;
+
+	CScriptArray *as_array = a.GetRef();
+	const char *expected = as_array->GetArrayObjectType()->GetEngine()->GetTypeDeclaration(as_array->GetArrayTypeId());
+	if(expected == NULL || decl != expected || header.element_size != sizeof(T)) return -3;
+
+	// other byte orders can only be converted for numbers
+	if(swap && !std::is_arithmetic<T>::value && !std::is_enum<T>::value && !std::is_same<T, std::string>::value) return -3;
+
+	// CScriptArray can't hold more than this
+	if(header.count > 0xFFFFFFFFu) return -2;
+
+	count = header.count;
+	return 0;
+}
+
+// primitive types
+template <class T, class A>
+int ScriptArraySTL_WriteElements(std::ostream &os, const CScriptArraySTL<T, A> &a, std::true_type)
+{
+	const char *data = (const char *)a.data();
+	size_t length = a.size() * sizeof(T);
+	for(size_t offset = 0; offset < length && os; offset += SCRIPTARRAYSTL_STREAM_CHUNK_BYTES)
+	{
+		size_t n = std::min<size_t>(length - offset, SCRIPTARRAYSTL_STREAM_CHUNK_BYTES);
+		os.write(data + offset, (std::streamsize)n);
+	}
+	return os ? 0 : -1;
+}
+
+template <class T, class A>
+int ScriptArraySTL_ReadElements(std::istream &is, CScriptArraySTL<T, A> &a, size_t count, bool swap, std::true_type)
+{
+	const size_t per_chunk = SCRIPTARRAYSTL_STREAM_CHUNK_BYTES / sizeof(T) > 0 ? SCRIPTARRAYSTL_STREAM_CHUNK_BYTES / sizeof(T) : 1;
+	for(size_t first = 0; first < count; first += per_chunk)
+	{
+		size_t n = std::min(count - first, per_chunk);
+		a.resize(first + n);
+		char *data = (char *)(a.data() + first);
+		if(!is.read(data, (std::streamsize)(n * sizeof(T))))
+		{
+			a.resize(first + (size_t)is.gcount() / sizeof(T));
+			return -1;
+		}
+		if(swap && sizeof(T) > 1) ScriptArraySTL_SwapBytes(data, sizeof(T), n);
+	}
+	return 0;
+}
+
+// value types that are stored as pointers to objects
+template <class T, class A>
+int ScriptArraySTL_WriteElements(std::ostream &os, const CScriptArraySTL<T, A> &a, std::false_type)
+{
+	const size_t per_chunk = SCRIPTARRAYSTL_STREAM_CHUNK_BYTES / sizeof(T) > 0 ? SCRIPTARRAYSTL_STREAM_CHUNK_BYTES / sizeof(T) : 1;
+	std::vector<char> chunk(per_chunk * sizeof(T));
+	for(size_t first = 0; first < a.size() && os; first += per_chunk)
+	{
+		size_t n = std::min(a.size() - first, per_chunk);
+		for(size_t i = 0; i < n; ++i)
+		{
+			memcpy(&chunk[i * sizeof(T)], &a[first + i], sizeof(T));
+		}
+		os.write(&chunk[0], (std::streamsize)(n * sizeof(T)));
+	}
+	return os ? 0 : -1;
+}
+
+template <class T, class A>
+int ScriptArraySTL_ReadElements(std::istream &is, CScriptArraySTL<T, A> &a, size_t count, bool, std::false_type)
+{
+	const size_t per_chunk = SCRIPTARRAYSTL_STREAM_CHUNK_BYTES / sizeof(T) > 0 ? SCRIPTARRAYSTL_STREAM_CHUNK_BYTES / sizeof(T) : 1;
+	std::vector<char> chunk(per_chunk * sizeof(T));
+	for(size_t first = 0; first < count; first += per_chunk)
+	{
+		size_t n = std::min(count - first, per_chunk);
+		if(!is.read(&chunk[0], (std::streamsize)(n * sizeof(T))))
+		{
+			n = (size_t)is.gcount() / sizeof(T);
+			a.resize(first + n);
+			for(size_t i = 0; i < n; ++i)
+			{
+				memcpy(&a[first + i], &chunk[i * sizeof(T)], sizeof(T));
+			}
+			return -1;
+		}
+		a.resize(first + n);
+		for(size_t i = 0; i < n; ++i)
+		{
+			memcpy(&a[first + i], &chunk[i * sizeof(T)], sizeof(T));
+		}
+	}
+	return 0;
+}
+
+// strings are gathered into chunks of lengths and characters
+template <class A>
+int ScriptArraySTL_WriteElements(std::ostream &os, const CScriptArraySTL<std::string, A> &a, std::false_type)
+{
+	std::vector<char> chunk;
+	chunk.reserve(SCRIPTARRAYSTL_STREAM_CHUNK_BYTES);
+	for(size_t i = 0; i < a.size() && os; ++i)
+	{
+		const std::string &str = a[i];
+		if(str.size() > 0xFFFFFFFFu) return -2;
+
+		asDWORD length = (asDWORD)str.size();
+		if(chunk.size() + sizeof(length) + length > SCRIPTARRAYSTL_STREAM_CHUNK_BYTES && !chunk.empty())
+		{
+			os.write(&chunk[0], (std::streamsize)chunk.size());
+			chunk.clear();
+		}
+		chunk.insert(chunk.end(), (const char *)&length, (const char *)&length + sizeof(length));
+
+		// long strings go straight to the stream
+		if(length > SCRIPTARRAYSTL_STREAM_CHUNK_BYTES)
+		{
+			os.write(&chunk[0], (std::streamsize)chunk.size());
+			chunk.clear();
+			os.write(str.data(), (std::streamsize)length);
+		}
+		else
+		{
+			chunk.insert(chunk.end(), str.begin(), str.end());
+		}
+	}
+	if(!chunk.empty()) os.write(&chunk[0], (std::streamsize)chunk.size());
+	return os ? 0 : -1;
+}
+
+template <class A>
+int ScriptArraySTL_ReadElements(std::istream &is, CScriptArraySTL<std::string, A> &a, size_t count, bool swap, std::false_type)
+{
+	// the array grows a chunk of strings at a time
+	const size_t per_chunk = SCRIPTARRAYSTL_STREAM_CHUNK_BYTES / sizeof(std::string);
+	for(size_t i = 0; i < count; ++i)
+	{
+		if(i == a.size()) a.resize(i + std::min(count - i, per_chunk));
+
+		asDWORD length;
+		if(!is.read((char *)&length, sizeof(length)))
+		{
+			a.resize(i);
+			return -1;
+		}
+		if(swap) ScriptArraySTL_SwapBytes(&length, sizeof(length), 1);
+
+		// the string grows as the characters arrive so a damaged length can't allocate everything
+		std::string &str = a[i];
+		str.clear();
+		while(length > 0)
+		{
+			size_t n = std::min<size_t>(length, SCRIPTARRAYSTL_STREAM_CHUNK_BYTES);
+			size_t old = str.size();
+			str.resize(old + n);
+			if(!is.read(&str[old], (std::streamsize)n))
+			{
+				a.resize(i);
+				return -1;
+			}
+			length -= (asDWORD)n;
+		}
+	}
+	return 0;
+}
+
+// Writes a snapshot of the array
+template <class T, class A>
+int save_array(std::ostream &os, const CScriptArraySTL<T, A> &a)
+{
+	static_assert(CScriptArraySTL_stream_traits<T>::block || CScriptArraySTL_stream_traits<T>::copied || std::is_same<T, std::string>::value,
+		"save_array() supports primitive types, strings and trivially copyable value types");
+
+	int result = ScriptArraySTL_WriteHeader(os, a);
+	if(result != 0) return result;
+
+	return ScriptArraySTL_WriteElements(os, a, std::integral_constant<bool, CScriptArraySTL_stream_traits<T>::block>());
+}
+
+// Replaces the contents of the array, which must already be initialized, with a snapshot. The array
+// grows as the elements arrive, so a damaged count can't make it allocate more than a chunk past
+// the end of the stream. If the stream fails after the header was read the array holds the
+// elements that were read before the failure.
+template <class T, class A>
+int load_array(std::istream &is, CScriptArraySTL<T, A> &a)
+{
+	static_assert(CScriptArraySTL_stream_traits<T>::block || CScriptArraySTL_stream_traits<T>::copied || std::is_same<T, std::string>::value,
+		"load_array() supports primitive types, strings and trivially copyable value types");
+
+	asQWORD count = 0;
+	bool swap = false;
+	int result = ScriptArraySTL_ReadHeader(is, a, count, swap);
+	if(result != 0) return result;
+
+	a.clear();
+	return ScriptArraySTL_ReadElements(is, a, (size_t)count, swap, std::integral_constant<bool, CScriptArraySTL_stream_traits<T>::block>());
+}
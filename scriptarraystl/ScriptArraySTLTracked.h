@@ -0,0 +1,315 @@
+// Script arrays that record which of their elements have changed.
+// CScriptArrayTracked can be used as the TArrayClass of CScriptArraySTL. The changes made through
+// CScriptArraySTL (see Change Tracking in ScriptArraySTL.h) and through the array's own C++
+// methods are recorded as ranges of element indices, and consume_dirty_ranges() hands them out
+// merged, so code that replicates or saves an array only has to deal with what changed.
+// Scripts write to arrays through references, which the array never sees. For element types that
+// are stored in the buffer itself (primitives and handles) EnableWriteDetection() keeps a checksum
+// of each block of elements, and every consume compares them to find the blocks that scripts
+// changed. Arrays of other object types only report changes made from C++.
+// To scripts it is a normal array<T>.
+//
+// Example:
+//     CScriptArraySTL<float, CScriptArrayTracked> state;
+//     state.InitArray(engine, 100000);
+//     state.GetRef()->EnableWriteDetection();
+//     ... run the script ...
+//     std::vector<SScriptArraySTLRange> changed = state.consume_dirty_ranges();
+// Copyright (c) 2014, Dominque A Douglas
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+//    in the documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+// OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include "ScriptArraySTLMemory.h"
+
+// when more ranges than this are recorded they are merged, and if that isn't enough they are
+// replaced by one range covering all of them
+#ifndef SCRIPTARRAYSTL_TRACKED_MAX_RANGES
+#define SCRIPTARRAYSTL_TRACKED_MAX_RANGES 1024
+#endif
+
+class CScriptArrayTracked : public CScriptArray
+{
+public:
+	CScriptArrayTracked(asUINT length, asIObjectType *ot)
+		:CScriptArray(length, ot), m_block_elements(0)
+	{
+	}
+
+	// allocated like a CScriptArray, since Release() frees it with the array add-on's memory functions
+	static void *operator new(size_t size)
+	{
+		return CScriptArraySTLMemory::AllocArray(size);
+	}
+
+	static void operator delete(void *ptr)
+	{
+		CScriptArraySTLMemory::FreeArray(ptr);
+	}
+
+	// records that the elements in [first, last) have changed
+	void MarkDirty(size_t first, size_t last)
+	{
+		if(first >= last) return;
+
+		// runs of writes to neighbouring elements grow the last range
+		if(!m_ranges.empty())
+		{
+			SScriptArraySTLRange &back = m_ranges.back();
+			if(first <= back.last && last >= back.first)
+			{
+				back.first = std::min(back.first, first);
+				back.last = std::max(back.last, last);
+				return;
+			}
+		}
+
+		SScriptArraySTLRange range = { first, last };
+		m_ranges.push_back(range);
+		if(m_ranges.size() > SCRIPTARRAYSTL_TRACKED_MAX_RANGES) Compact();
+	}
+
+	// true if changes have been recorded since the last consume. Writes made by scripts are only
+	// found by a consume.
+	bool HasDirtyRanges() const
+	{
+		return !m_ranges.empty();
+	}
+
+	// Starts checking for writes made by scripts, in blocks of block_elements elements. Only for
+	// element types that are stored in the buffer.
+	void EnableWriteDetection(size_t block_elements = 64)
+	{
+		assert((!(subTypeId & asTYPEID_MASK_OBJECT) || (subTypeId & asTYPEID_OBJHANDLE)) &&
+			"Write detection needs an element type that is stored in the array's buffer.");
+
+		m_block_elements = block_elements > 0 ? block_elements : 1;
+		m_checksums.clear();
+		UpdateChecksums(false);
+	}
+
+	void DisableWriteDetection()
+	{
+		m_block_elements = 0;
+		m_checksums.clear();
+	}
+
+	bool IsWriteDetectionEnabled() const
+	{
+		return m_block_elements > 0;
+	}
+
+	// Returns the ranges that changed since the last call, sorted and merged and limited to the
+	// current size, and starts recording again
+	std::vector<SScriptArraySTLRange> ConsumeDirtyRanges()
+	{
+		if(m_block_elements > 0) UpdateChecksums(true);
+		return ConsumeRecordedRanges();
+	}
+
+	// Same as ConsumeDirtyRanges() without comparing the checksums, so it only returns the changes
+	// made from C++. Writes made by scripts since then are still found by the next
+	// ConsumeDirtyRanges().
+	std::vector<SScriptArraySTLRange> ConsumeRecordedRanges()
+	{
+		Merge();
+
+		// ranges past the end of the array were removed
+		size_t size = GetSize();
+		std::vector<SScriptArraySTLRange> ranges;
+		ranges.reserve(m_ranges.size());
+		for(size_t i = 0; i < m_ranges.size(); ++i)
+		{
+			SScriptArraySTLRange range = m_ranges[i];
+			if(range.first >= size) break;
+			range.last = std::min(range.last, size);
+			ranges.push_back(range);
+		}
+		m_ranges.clear();
+
+		return ranges;
+	}
+
+	// these hide the CScriptArray versions so that changes made through them are recorded
+	void Resize(asUINT numElements)
+	{
+		asUINT old_size = GetSize();
+		CScriptArray::Resize(numElements);
+		MarkDirty(old_size, numElements);
+	}
+
+	void InsertAt(asUINT index, void *value)
+	{
+		CScriptArray::InsertAt(index, value);
+		MarkDirty(index, GetSize());
+	}
+
+	void InsertLast(void *value)
+	{
+		CScriptArray::InsertLast(value);
+		MarkDirty(GetSize() - 1, GetSize());
+	}
+
+	void RemoveAt(asUINT index)
+	{
+		CScriptArray::RemoveAt(index);
+		MarkDirty(index, GetSize());
+	}
+
+	void SetValue(asUINT index, void *value)
+	{
+		CScriptArray::SetValue(index, value);
+		MarkDirty(index, index + 1);
+	}
+
+	void *At(asUINT index)
+	{
+		MarkDirty(index, index + 1);
+		return CScriptArray::At(index);
+	}
+
+	const void *At(asUINT index) const
+	{
+		return CScriptArray::At(index);
+	}
+
+	void SortAsc()
+	{
+		CScriptArray::SortAsc();
+		MarkDirty(0, GetSize());
+	}
+
+	void SortDesc()
+	{
+		CScriptArray::SortDesc();
+		MarkDirty(0, GetSize());
+	}
+
+	void Reverse()
+	{
+		CScriptArray::Reverse();
+		MarkDirty(0, GetSize());
+	}
+
+private:
+	std::vector<SScriptArraySTLRange> m_ranges;
+	size_t                            m_block_elements; // 0 when write detection is off
+	std::vector<asQWORD>              m_checksums;
+
+	CScriptArrayTracked(const CScriptArrayTracked &);
+	CScriptArrayTracked &operator = (const CScriptArrayTracked &);
+
+	// sorts the ranges and merges the ones that overlap or touch
+	void Merge()
+	{
+		if(m_ranges.size() < 2) return;
+
+		std::sort(m_ranges.begin(), m_ranges.end(), CompareFirst);
+		size_t kept = 0;
+		for(size_t i = 1; i < m_ranges.size(); ++i)
+		{
+			if(m_ranges[i].first <= m_ranges[kept].last)
+			{
+				m_ranges[kept].last = std::max(m_ranges[kept].last, m_ranges[i].last);
+			}
+			else
+			{
+				m_ranges[++kept] = m_ranges[i];
+			}
+		}
+		m_ranges.resize(kept + 1);
+	}
+
+	// called when there are too many ranges
+	void Compact()
+	{
+		Merge();
+		if(m_ranges.size() > SCRIPTARRAYSTL_TRACKED_MAX_RANGES / 2)
+		{
+			m_ranges.front().last = m_ranges.back().last;
+			m_ranges.resize(1);
+		}
+	}
+
+	static bool CompareFirst(const SScriptArraySTLRange &a, const SScriptArraySTLRange &b)
+	{
+		return a.first < b.first;
+	}
+
+	// Recomputes the checksum of each block. If mark is true, blocks whose checksum changed and
+	// blocks that didn't exist before are recorded as changed.
+	void UpdateChecksums(bool mark)
+	{
+		size_t size = GetSize();
+		size_t blocks = (size + m_block_elements - 1) / m_block_elements;
+		size_t old_blocks = m_checksums.size();
+		m_checksums.resize(blocks);
+
+		for(size_t b = 0; b < blocks; ++b)
+		{
+			size_t first = b * m_block_elements;
+			size_t last = std::min(size, first + m_block_elements);
+
+			// the length is part of the checksum so a partial last block that grows is found
+			asQWORD checksum = Checksum(buffer->data + first * elementSize, (last - first) * elementSize) ^ (asQWORD)(last - first);
+			if(mark && (b >= old_blocks || checksum != m_checksums[b])) MarkDirty(first, last);
+			m_checksums[b] = checksum;
+		}
+	}
+
+	// FNV-1a over 8 bytes at a time
+	static asQWORD Checksum(const asBYTE *data, size_t length)
+	{
+		asQWORD hash = 14695981039346656037ULL;
+		size_t i = 0;
+		for(; i + 8 <= length; i += 8)
+		{
+			asQWORD word;
+			memcpy(&word, data + i, 8);
+			hash = (hash ^ word) * 1099511628211ULL;
+		}
+		for(; i < length; ++i)
+		{
+			hash = (hash ^ data[i]) * 1099511628211ULL;
+		}
+		return hash;
+	}
+};
+
+// CScriptArraySTL records its changes in the array
+template <>
+struct CScriptArraySTL_tracker<CScriptArrayTracked>
+{
+	static void MarkDirty(CScriptArrayTracked *as_array, size_t first, size_t last)
+	{
+		as_array->MarkDirty(first, last);
+	}
+
+	static std::vector<SScriptArraySTLRange> ConsumeDirtyRanges(CScriptArrayTracked *as_array)
+	{
+		return as_array->ConsumeDirtyRanges();
+	}
+};
+
+template <>
+struct CScriptArraySTL_heap_buffer<CScriptArrayTracked>
+{
+	static const bool value = true;
+};
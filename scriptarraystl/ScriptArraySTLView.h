@@ -0,0 +1,235 @@
+// Zero-copy views of C++ buffers as script arrays.
+// CScriptArray keeps its element count and capacity in a small header directly in front of the
+// elements, so a C++ buffer can only be shown to scripts without copying if there is room for
+// that header in front of it. CScriptArraySTLViewAllocator is a std::allocator replacement that
+// reserves this room, so a std::vector<T, CScriptArraySTLViewAllocator<T> > can be viewed by
+// scripts directly. Only primitive element types can be viewed.
+// CScriptArrayView can be used as the TArrayClass of CScriptArraySTL. Bind() points it at the
+// elements of a buffer and to scripts it looks like a normal array<T> of that many elements.
+//
+// To make the view read-only, give it to scripts as a const array<T> (ie register it as a
+// "const array<float>" property or pass it as "const array<float> &in"). A script that is given
+// a writable view writes straight into the C++ buffer, and if the script resizes it the array
+// copies the data into a buffer of its own and stops viewing the C++ buffer.
+//
+// Lifetime rules
+// - While bound, the C++ buffer must stay alive and must not move. Anything that reallocates a
+//   std::vector (push_back past capacity, reserve, shrink_to_fit) moves it. Call Bind() again
+//   with the new data() afterwards.
+// - Scripts can hold references to the array after the C++ side is done with it. Call Unbind()
+//   before destroying the buffer. After that scripts see an empty array.
+// - CScriptArraySTLMemory::Install() must have been called, since a script that resizes a
+//   writable view frees the viewed block through the array add-on's memory functions.
+// Copyright (c) 2014, Dominque A Douglas
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+//    in the documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+// OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#pragma once
+
+#include <stddef.h>
+#include <new>
+#include <vector>
+
+#include "ScriptArraySTLMemory.h"
+
+// The source that blocks made by CScriptArraySTLViewAllocator are marked with. The memory is owned
+// by the container using the allocator, so it is never freed through here.
+class CScriptArraySTLViewSource : public CScriptArraySTLBufferSource
+{
+public:
+	static CScriptArraySTLViewSource *Get()
+	{
+		static CScriptArraySTLViewSource source;
+		return &source;
+	}
+
+	virtual void *AllocateBlock(size_t)
+	{
+		return NULL;
+	}
+
+	virtual void FreeBlock(void *, size_t)
+	{
+		// a script resized a view and the array moved to a buffer of its own. The memory
+		// still belongs to the C++ container.
+	}
+};
+
+// bytes reserved in front of every allocation for the block header and the array buffer header
+static const size_t SCRIPTARRAYSTL_VIEW_PREFIX = sizeof(SScriptArraySTLBlock) + offsetof(SArrayBuffer, data);
+
+// std::allocator replacement that leaves room in front of every allocation so it can be viewed
+// by a CScriptArrayView without copying
+template <class T>
+class CScriptArraySTLViewAllocator
+{
+public:
+	typedef T         value_type;
+	typedef T        *pointer;
+	typedef const T  *const_pointer;
+	typedef T        &reference;
+	typedef const T  &const_reference;
+	typedef size_t    size_type;
+	typedef ptrdiff_t difference_type;
+
+	template <class U>
+	struct rebind
+	{
+		typedef CScriptArraySTLViewAllocator<U> other;
+	};
+
+	CScriptArraySTLViewAllocator()
+	{
+	}
+
+	template <class U>
+	CScriptArraySTLViewAllocator(const CScriptArraySTLViewAllocator<U> &)
+	{
+	}
+
+	pointer allocate(size_type n)
+	{
+		size_t size = SCRIPTARRAYSTL_VIEW_PREFIX + n * sizeof(T);
+		void *memory = asAllocMem(size);
+		if(memory == NULL) throw std::bad_alloc();
+
+		CScriptArraySTLMemory::InitBlock(memory, size, CScriptArraySTLViewSource::Get());
+
+		return (pointer)((char *)memory + SCRIPTARRAYSTL_VIEW_PREFIX);
+	}
+
+	void deallocate(pointer p, size_type)
+	{
+		asFreeMem((char *)p - SCRIPTARRAYSTL_VIEW_PREFIX);
+	}
+
+	bool operator == (const CScriptArraySTLViewAllocator &) const
+	{
+		return true;
+	}
+
+	bool operator != (const CScriptArraySTLViewAllocator &) const
+	{
+		return false;
+	}
+};
+
+// Script array that shows the elements of a C++ buffer instead of its own
+class CScriptArrayView : public CScriptArray
+{
+public:
+	CScriptArrayView(asUINT length, asIObjectType *ot)
+		:CScriptArray(length, ot), m_own_buffer(NULL), m_bound(NULL)
+	{
+	}
+
+	virtual ~CScriptArrayView()
+	{
+		// give the base class its own buffer back to delete
+		if(buffer == m_bound)
+		{
+			buffer = m_own_buffer;
+		}
+		else if(m_own_buffer != NULL)
+		{
+			DeleteBuffer(m_own_buffer);
+		}
+	}
+
+	// allocated like a CScriptArray, since Release() frees it with the array add-on's memory functions
+	static void *operator new(size_t size)
+	{
+		return CScriptArraySTLMemory::AllocArray(size);
+	}
+
+	static void operator delete(void *ptr)
+	{
+		CScriptArraySTLMemory::FreeArray(ptr);
+	}
+
+	// Views count elements starting at data. data must have been allocated by
+	// CScriptArraySTLViewAllocator. Binding again replaces the previous view.
+	void Bind(void *data, asUINT count)
+	{
+		// an empty std::vector may not have allocated anything yet
+		if(data == NULL)
+		{
+			Unbind();
+			return;
+		}
+
+		assert(CScriptArraySTLMemory::IsInstalled() && "CScriptArraySTLMemory::Install() must be called first.");
+		assert(!(subTypeId & asTYPEID_MASK_OBJECT) && "Only arrays of primitives can be views.");
+		assert((CScriptArraySTLMemory::GetBlock((char *)data - offsetof(SArrayBuffer, data))->source == CScriptArraySTLViewSource::Get())
+			&& "The buffer wasn't allocated by CScriptArraySTLViewAllocator.");
+
+		SArrayBuffer *header = (SArrayBuffer *)((char *)data - offsetof(SArrayBuffer, data));
+		header->maxElements = count;
+		header->numElements = count;
+
+		if(m_own_buffer == NULL)
+		{
+			// keep the array's own buffer for when the view is unbound
+			m_own_buffer = buffer;
+		}
+		else if(buffer != m_bound)
+		{
+			// a script resized the previous view, so drop the copy it made
+			DeleteBuffer(buffer);
+		}
+		buffer = header;
+		m_bound = header;
+	}
+
+	// Stops viewing the C++ buffer. The array is empty afterwards.
+	void Unbind()
+	{
+		if(m_own_buffer == NULL) return;
+
+		if(buffer != m_bound)
+		{
+			DeleteBuffer(buffer);
+		}
+		buffer = m_own_buffer;
+		m_own_buffer = NULL;
+		m_bound = NULL;
+		CScriptArray::Resize(0);
+	}
+
+	// returns true while the array is showing a C++ buffer. This is false after a script
+	// resized the array, since it then has a copy of its own.
+	bool IsBound() const
+	{
+		return (m_bound != NULL) && (buffer == m_bound);
+	}
+
+protected:
+	SArrayBuffer *m_own_buffer; // the array's own buffer while a C++ buffer is bound
+	SArrayBuffer *m_bound;      // header in front of the bound C++ buffer
+};
+
+// Creates a script array that views the elements of v
+template <class T>
+CScriptArraySTL<T, CScriptArrayView> ScriptArraySTL_MakeView(asIScriptEngine *engine, std::vector<T, CScriptArraySTLViewAllocator<T> > &v)
+{
+	static_assert(CScriptArraySTL_is_contiguous<T>::value && !std::is_pointer<T>::value, "Only arrays of primitives can be views");
+
+	CScriptArraySTL<T, CScriptArrayView> view;
+	if(view.InitArray(engine) >= 0)
+	{
+		view.GetRef()->Bind(v.data(), (asUINT)v.size());
+	}
+	return view;
+}
@@ -0,0 +1,597 @@
+// Benchmarks for CScriptArraySTL.
+// Times common operations on CScriptArraySTL and compares them with std::vector and with using
+// CScriptArray directly. Each operation is run for int, float, std::string and a registered value
+// type (vec3) at sizes from 10 to 10M elements, and reports the time per element in nanoseconds
+// and the number of heap allocations per element. Allocations are counted for both C++ new and
+// everything AngelScript allocates.
+// A "-" means the operation doesn't apply to that container, for example CScriptArray has no
+// iterators and can't sort a value type that has no opCmp.
+//
+// Build it with the Makefile in this folder and run
+//     ./ScriptArraySTLBenchmark [--max-size N] [--max-push-back N] [--type int|float|string|vec3] [--op name]
+// The operations are access (random order reads), index, iterator, reverse, push_back, assign,
+// resize and sort.
+// Copyright (c) 2014, Dominque A Douglas
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer
+//    in the documentation and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+// OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <angelscript.h>
+#include "scriptstdstring/scriptstdstring.h"
+#include "scriptarray/scriptarray.h"
+
+#include "../ScriptArraySTL.h"
+
+// Allocation counting -----------------------------------------------------------------------
+// GCC can't tell that the replaced new and delete below are a matching malloc/free pair
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+static std::atomic<size_t> g_allocations(0);
+
+void *operator new(size_t size)
+{
+	g_allocations.fetch_add(1, std::memory_order_relaxed);
+	void *p = malloc(size ? size : 1);
+	if(p == NULL) throw std::bad_alloc();
+	return p;
+}
+void *operator new[](size_t size)                 { return operator new(size); }
+void operator delete(void *p) noexcept            { free(p); }
+void operator delete[](void *p) noexcept          { free(p); }
+void operator delete(void *p, size_t) noexcept    { free(p); }
+void operator delete[](void *p, size_t) noexcept  { free(p); }
+
+// used for the engine and the array add-on
+static void *CountedAlloc(size_t size)
+{
+	g_allocations.fetch_add(1, std::memory_order_relaxed);
+	return malloc(size);
+}
+static void CountedFree(void *p)
+{
+	free(p);
+}
+
+// Element types -----------------------------------------------------------------------------
+// a registered POD value type. The script array stores these as pointers to separate objects.
+struct Vec3
+{
+	float x, y, z;
+};
+
+inline bool operator < (const Vec3 &a, const Vec3 &b)
+{
+	if(a.x != b.x) return a.x < b.x;
+	if(a.y != b.y) return a.y < b.y;
+	return a.z < b.z;
+}
+
+template <> struct CScriptArraySTL_type<Vec3> { static const char *decl() { return "vec3"; } };
+
+// how each element type is named, generated and read. hash() turns an element into something
+// that can be added to g_sink so the reads can't be optimized away.
+template <class T> struct SBenchType;
+
+template <> struct SBenchType<int>
+{
+	static const char *name()          { return "int"; }
+	static int make(size_t i)          { return (int)(i * 2654435761u % 1000003); }
+	static size_t hash(const int &v)   { return (size_t)v; }
+	static bool script_sortable()      { return true; }
+};
+
+template <> struct SBenchType<float>
+{
+	static const char *name()          { return "float"; }
+	static float make(size_t i)        { return (float)(i * 2654435761u % 1000003) * 0.5f; }
+	static size_t hash(const float &v) { return (size_t)v; }
+	static bool script_sortable()      { return true; }
+};
+
+template <> struct SBenchType<std::string>
+{
+	static const char *name()                { return "string"; }
+	static std::string make(size_t i)        { return std::to_string(i * 2654435761u % 1000003); }
+	static size_t hash(const std::string &v) { return v.size() + (size_t)v[0]; }
+	static bool script_sortable()            { return true; }
+};
+
+template <> struct SBenchType<Vec3>
+{
+	static const char *name()          { return "vec3"; }
+	static Vec3 make(size_t i)         { float f = (float)(i * 2654435761u % 1000003); Vec3 v = { f, f + 1, f + 2 }; return v; }
+	static size_t hash(const Vec3 &v)  { return (size_t)v.x; }
+	static bool script_sortable()      { return false; } // no opCmp is registered
+};
+
+static asIScriptEngine *g_engine = NULL;
+static volatile size_t g_sink = 0;
+
+// Containers --------------------------------------------------------------------------------
+// Each adapter gives the benchmarks one interface to a container. Operations that a container
+// doesn't have return false.
+template <class T>
+struct SVectorBench
+{
+	typedef std::vector<T> container;
+
+	static void create(container &c, size_t n)                 { c.resize(n); }
+	static void destroy(container &c)                          { container().swap(c); }
+	static const T &get(container &c, size_t i)                { return c[i]; }
+	static void set(container &c, size_t i, const T &v)        { c[i] = v; }
+	static void push_back(container &c, const T &v)            { c.push_back(v); }
+	static void resize(container &c, size_t n)                 { c.resize(n); }
+	static void assign(container &c, const std::vector<T> &s)  { c.assign(s.begin(), s.end()); }
+	static bool sort(container &c)                             { std::sort(c.begin(), c.end()); return true; }
+
+	template <class F> static bool iterate(container &c, F f)
+	{
+		for(typename container::iterator it = c.begin(); it != c.end(); ++it) f(*it);
+		return true;
+	}
+	template <class F> static bool iterate_reverse(container &c, F f)
+	{
+		for(typename container::reverse_iterator it = c.rbegin(); it != c.rend(); ++it) f(*it);
+		return true;
+	}
+};
+
+// CScriptArray used directly, the way an application would without the wrapper
+template <class T>
+struct SScriptArrayBench
+{
+	typedef CScriptArray *container;
+
+	static void create(container &c, size_t n)                 { c = CScriptArray::Create(CScriptArraySTLTypeCache::GetArrayType<T>(g_engine), (asUINT)n); }
+	static void destroy(container &c)                          { if(c != NULL) c->Release(); c = NULL; }
+	static const T &get(container &c, size_t i)                { return *(const T *)c->At((asUINT)i); }
+	static void set(container &c, size_t i, const T &v)        { *(T *)c->At((asUINT)i) = v; }
+	static void push_back(container &c, const T &v)            { c->InsertLast((void *)&v); }
+	static void resize(container &c, size_t n)                 { c->Resize((asUINT)n); }
+	static void assign(container &c, const std::vector<T> &s)
+	{
+		c->Resize((asUINT)s.size());
+		for(size_t i = 0; i < s.size(); ++i) *(T *)c->At((asUINT)i) = s[i];
+	}
+	static bool sort(container &c)
+	{
+		if(!SBenchType<T>::script_sortable()) return false;
+		c->SortAsc();
+		return true;
+	}
+
+	template <class F> static bool iterate(container &, F)         { return false; }
+	template <class F> static bool iterate_reverse(container &, F) { return false; }
+};
+
+template <class T>
+struct SScriptArraySTLBench
+{
+	typedef CScriptArraySTL<T> container;
+
+	static void create(container &c, size_t n)                 { c.InitArray(g_engine, n); }
+	static void destroy(container &c)                          { c = container(); }
+	static const T &get(container &c, size_t i)                { return c[i]; }
+	static void set(container &c, size_t i, const T &v)        { c[i] = v; }
+	static void push_back(container &c, const T &v)            { c.push_back(v); }
+	static void resize(container &c, size_t n)                 { c.resize(n); }
+	static void assign(container &c, const std::vector<T> &s)  { c.assign(s.begin(), s.end()); }
+	static bool sort(container &c)                             { c.sort(); return true; }
+
+	template <class F> static bool iterate(container &c, F f)
+	{
+		for(typename container::iterator it = c.begin(); it != c.end(); ++it) f(*it);
+		return true;
+	}
+	template <class F> static bool iterate_reverse(container &c, F f)
+	{
+		for(typename container::reverse_iterator it = c.rbegin(); it != c.rend(); ++it) f(*it);
+		return true;
+	}
+};
+
+// Measurements ------------------------------------------------------------------------------
+struct SResult
+{
+	bool valid;
+	double ns_per_element;
+	double allocations_per_element;
+};
+
+class CMeasurement
+{
+public:
+	void Start()
+	{
+		m_allocations = g_allocations.load();
+		m_start = std::chrono::steady_clock::now();
+	}
+
+	SResult Stop(size_t elements)
+	{
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+		SResult r;
+		r.valid = true;
+		r.ns_per_element = std::chrono::duration<double, std::nano>(end - m_start).count() / (double)elements;
+		r.allocations_per_element = (double)(g_allocations.load() - m_allocations) / (double)elements;
+		return r;
+	}
+
+	static SResult NotAvailable()
+	{
+		SResult r = { false, 0.0, 0.0 };
+		return r;
+	}
+
+private:
+	size_t m_allocations;
+	std::chrono::steady_clock::time_point m_start;
+};
+
+template <class A, class T>
+static void Fill(typename A::container &c, const std::vector<T> &src)
+{
+	A::create(c, src.size());
+	for(size_t i = 0; i < src.size(); ++i) A::set(c, i, src[i]);
+}
+
+static size_t Gcd(size_t a, size_t b)
+{
+	while(b != 0) { size_t t = a % b; a = b; b = t; }
+	return a;
+}
+
+// Each benchmark runs the operation reps times over n = src.size() elements.
+struct SAccessBench
+{
+	static const char *name() { return "access"; }
+
+	template <class A, class T> static SResult Run(const std::vector<T> &src, size_t reps)
+	{
+		typename A::container c = typename A::container();
+		Fill<A>(c, src);
+
+		// visit every element once in a scattered order
+		size_t n = src.size();
+		size_t step = 7919 % n;
+		if(step == 0 || Gcd(step, n) != 1) step = 1;
+
+		size_t sink = 0;
+		CMeasurement m;
+		m.Start();
+		for(size_t r = 0; r < reps; ++r)
+		{
+			size_t k = 0;
+			for(size_t i = 0; i < n; ++i)
+			{
+				sink += SBenchType<T>::hash(A::get(c, k));
+				k += step;
+				if(k >= n) k -= n;
+			}
+		}
+		SResult result = m.Stop(n * reps);
+		g_sink += sink;
+
+		A::destroy(c);
+		return result;
+	}
+};
+
+struct SIndexBench
+{
+	static const char *name() { return "index"; }
+
+	template <class A, class T> static SResult Run(const std::vector<T> &src, size_t reps)
+	{
+		typename A::container c = typename A::container();
+		Fill<A>(c, src);
+
+		size_t n = src.size();
+		size_t sink = 0;
+		CMeasurement m;
+		m.Start();
+		for(size_t r = 0; r < reps; ++r)
+		{
+			for(size_t i = 0; i < n; ++i) sink += SBenchType<T>::hash(A::get(c, i));
+		}
+		SResult result = m.Stop(n * reps);
+		g_sink += sink;
+
+		A::destroy(c);
+		return result;
+	}
+};
+
+struct SIteratorBench
+{
+	static const char *name() { return "iterator"; }
+
+	template <class A, class T> static SResult Run(const std::vector<T> &src, size_t reps)
+	{
+		typename A::container c = typename A::container();
+		Fill<A>(c, src);
+
+		size_t sink = 0;
+		bool available = true;
+		CMeasurement m;
+		m.Start();
+		for(size_t r = 0; r < reps && available; ++r)
+		{
+			available = A::iterate(c, [&sink](const T &v) { sink += SBenchType<T>::hash(v); });
+		}
+		SResult result = available ? m.Stop(src.size() * reps) : CMeasurement::NotAvailable();
+		g_sink += sink;
+
+		A::destroy(c);
+		return result;
+	}
+};
+
+struct SReverseBench
+{
+	static const char *name() { return "reverse"; }
+
+	template <class A, class T> static SResult Run(const std::vector<T> &src, size_t reps)
+	{
+		typename A::container c = typename A::container();
+		Fill<A>(c, src);
+
+		size_t sink = 0;
+		bool available = true;
+		CMeasurement m;
+		m.Start();
+		for(size_t r = 0; r < reps && available; ++r)
+		{
+			available = A::iterate_reverse(c, [&sink](const T &v) { sink += SBenchType<T>::hash(v); });
+		}
+		SResult result = available ? m.Stop(src.size() * reps) : CMeasurement::NotAvailable();
+		g_sink += sink;
+
+		A::destroy(c);
+		return result;
+	}
+};
+
+// includes creating and destroying the container, the same for every container.
+// CScriptArray grows its buffer by exactly what is needed, so push_back copies the whole array
+// every time and large sizes would take hours. These are limited by --max-push-back.
+struct SPushBackBench
+{
+	static const char *name() { return "push_back"; }
+
+	template <class A, class T> static SResult Run(const std::vector<T> &src, size_t reps)
+	{
+		CMeasurement m;
+		m.Start();
+		for(size_t r = 0; r < reps; ++r)
+		{
+			typename A::container c = typename A::container();
+			A::create(c, 0);
+			for(size_t i = 0; i < src.size(); ++i) A::push_back(c, src[i]);
+			A::destroy(c);
+		}
+		return m.Stop(src.size() * reps);
+	}
+};
+
+struct SAssignBench
+{
+	static const char *name() { return "assign"; }
+
+	template <class A, class T> static SResult Run(const std::vector<T> &src, size_t reps)
+	{
+		typename A::container c = typename A::container();
+		A::create(c, 0);
+
+		CMeasurement m;
+		m.Start();
+		for(size_t r = 0; r < reps; ++r)
+		{
+			A::assign(c, src);
+			A::resize(c, 0);
+		}
+		SResult result = m.Stop(src.size() * reps);
+
+		A::destroy(c);
+		return result;
+	}
+};
+
+struct SResizeBench
+{
+	static const char *name() { return "resize"; }
+
+	template <class A, class T> static SResult Run(const std::vector<T> &src, size_t reps)
+	{
+		typename A::container c = typename A::container();
+		A::create(c, 0);
+
+		CMeasurement m;
+		m.Start();
+		for(size_t r = 0; r < reps; ++r)
+		{
+			A::resize(c, src.size());
+			A::resize(c, 0);
+		}
+		SResult result = m.Stop(src.size() * reps);
+
+		A::destroy(c);
+		return result;
+	}
+};
+
+// only the sorting is timed. Each repetition sorts its own unsorted copy.
+struct SSortBench
+{
+	static const char *name() { return "sort"; }
+
+	template <class A, class T> static SResult Run(const std::vector<T> &src, size_t reps)
+	{
+		std::vector<typename A::container> copies(reps);
+		for(size_t r = 0; r < reps; ++r) Fill<A>(copies[r], src);
+
+		bool available = true;
+		CMeasurement m;
+		m.Start();
+		for(size_t r = 0; r < reps && available; ++r) available = A::sort(copies[r]);
+		SResult result = available ? m.Stop(src.size() * reps) : CMeasurement::NotAvailable();
+
+		for(size_t r = 0; r < reps; ++r) A::destroy(copies[r]);
+		return result;
+	}
+};
+
+// Driver ------------------------------------------------------------------------------------
+struct SOptions
+{
+	size_t max_size;
+	size_t max_push_back; // largest push_back size for the script arrays
+	size_t budget;        // elements processed per measurement
+	const char *type;     // NULL runs every type
+	const char *op;       // NULL runs every operation
+};
+
+// the largest size the script arrays are measured at for each benchmark
+template <class B>
+struct SScriptArraySizeLimit
+{
+	static size_t get(const SOptions &options) { return options.max_size; }
+};
+
+template <>
+struct SScriptArraySizeLimit<SPushBackBench>
+{
+	static size_t get(const SOptions &options) { return options.max_push_back; }
+};
+
+static void PrintResult(const SResult &r)
+{
+	if(r.valid) printf(" | %10.2f %9.3f", r.ns_per_element, r.allocations_per_element);
+	else printf(" | %10s %9s", "-", "-");
+}
+
+template <class B, class T>
+static void RunBench(const SOptions &options, const std::vector<T> &src)
+{
+	if(options.op != NULL && strcmp(options.op, B::name()) != 0) return;
+
+	size_t reps = std::max<size_t>(1, options.budget / src.size());
+	SResult vector_result = B::template Run<SVectorBench<T> >(src, reps);
+	SResult array_result = CMeasurement::NotAvailable();
+	SResult wrapper_result = CMeasurement::NotAvailable();
+	if(src.size() <= SScriptArraySizeLimit<B>::get(options))
+	{
+		array_result = B::template Run<SScriptArrayBench<T> >(src, reps);
+		wrapper_result = B::template Run<SScriptArraySTLBench<T> >(src, reps);
+	}
+
+	printf("%-7s %-10s %9zu", SBenchType<T>::name(), B::name(), src.size());
+	PrintResult(vector_result);
+	PrintResult(array_result);
+	PrintResult(wrapper_result);
+	printf("\n");
+	fflush(stdout);
+}
+
+template <class T>
+static void RunType(const SOptions &options)
+{
+	if(options.type != NULL && strcmp(options.type, SBenchType<T>::name()) != 0) return;
+
+	for(size_t n = 10; n <= options.max_size; n *= 10)
+	{
+		std::vector<T> src(n);
+		for(size_t i = 0; i < n; ++i) src[i] = SBenchType<T>::make(i);
+
+		RunBench<SAccessBench>(options, src);
+		RunBench<SIndexBench>(options, src);
+		RunBench<SIteratorBench>(options, src);
+		RunBench<SReverseBench>(options, src);
+		RunBench<SPushBackBench>(options, src);
+		RunBench<SAssignBench>(options, src);
+		RunBench<SResizeBench>(options, src);
+		RunBench<SSortBench>(options, src);
+	}
+}
+
+static void MessageCallback(const asSMessageInfo *msg, void *)
+{
+	const char *type = "ERR ";
+	if( msg->type == asMSGTYPE_WARNING ) type = "WARN";
+	else if( msg->type == asMSGTYPE_INFORMATION ) type = "INFO";
+
+	printf("%s (%d, %d) : %s : %s\n", msg->section, msg->row, msg->col, type, msg->message);
+}
+
+static int RegisterVec3(asIScriptEngine *engine)
+{
+	int r;
+	r = engine->RegisterObjectType("vec3", sizeof(Vec3), asOBJ_VALUE | asOBJ_POD | asOBJ_APP_CLASS_ALLFLOATS | asGetTypeTraits<Vec3>()); if(r < 0) return r;
+	r = engine->RegisterObjectProperty("vec3", "float x", asOFFSET(Vec3, x)); if(r < 0) return r;
+	r = engine->RegisterObjectProperty("vec3", "float y", asOFFSET(Vec3, y)); if(r < 0) return r;
+	r = engine->RegisterObjectProperty("vec3", "float z", asOFFSET(Vec3, z)); if(r < 0) return r;
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	SOptions options = { 10000000, 100000, 2000000, NULL, NULL };
+	for(int i = 1; i < argc; ++i)
+	{
+		if(strcmp(argv[i], "--max-size") == 0 && i + 1 < argc) options.max_size = (size_t)strtoull(argv[++i], NULL, 10);
+		else if(strcmp(argv[i], "--max-push-back") == 0 && i + 1 < argc) options.max_push_back = (size_t)strtoull(argv[++i], NULL, 10);
+		else if(strcmp(argv[i], "--type") == 0 && i + 1 < argc) options.type = argv[++i];
+		else if(strcmp(argv[i], "--op") == 0 && i + 1 < argc) options.op = argv[++i];
+		else
+		{
+			printf("usage: %s [--max-size N] [--max-push-back N] [--type int|float|string|vec3] [--op name]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	// count everything the engine and the array add-on allocate
+	asSetGlobalMemoryFunctions(CountedAlloc, CountedFree);
+	CScriptArray::SetMemoryFunctions(CountedAlloc, CountedFree);
+
+	g_engine = asCreateScriptEngine(ANGELSCRIPT_VERSION);
+	int r = g_engine->SetMessageCallback(asFUNCTION(MessageCallback), 0, asCALL_CDECL); assert( r >= 0 );
+	RegisterStdString(g_engine);
+	RegisterScriptArray(g_engine, true);
+	r = RegisterVec3(g_engine); assert( r >= 0 );
+	(void)r;
+
+	printf("%-7s %-10s %9s | %-20s | %-20s | %-20s\n", "type", "operation", "elements", "std::vector", "CScriptArray", "CScriptArraySTL");
+	printf("%-7s %-10s %9s | %10s %9s | %10s %9s | %10s %9s\n", "", "", "", "ns/elem", "allocs", "ns/elem", "allocs", "ns/elem", "allocs");
+
+	RunType<int>(options);
+	RunType<float>(options);
+	RunType<std::string>(options);
+	RunType<Vec3>(options);
+
+	g_engine->Release();
+	return 0;
+}
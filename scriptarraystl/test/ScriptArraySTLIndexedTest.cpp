@@ -0,0 +1,113 @@
+// Tests that CScriptArrayIndexed keeps its index up to date with changes made from C++, picks up
+// writes it didn't see when Update() is called, and finds the first position of repeated values.
+#include <limits>
+#include <string>
+
+#include "ScriptArraySTLTestUtil.h"
+#include "../ScriptArraySTLIndexed.h"
+
+static int Find(CScriptArraySTL<int, CScriptArrayIndexed> &a, int value)
+{
+	return a.GetRef()->IndexOf(&value);
+}
+
+static void TestApply(asIScriptEngine *engine)
+{
+	CScriptArraySTL<int, CScriptArrayIndexed> a;
+	a.InitArray(engine);
+	for(int i = 0; i < 1000; ++i) a.push_back(i * 3);
+
+	SCRIPTARRAYSTL_CHECK(Find(a, 0) == 0 && Find(a, 2997) == 999 && Find(a, 1) == -1);
+
+	// writes through the wrapper are re-hashed by the next lookup
+	a[10] = 7;
+	SCRIPTARRAYSTL_CHECK(Find(a, 7) == 10 && Find(a, 30) == -1);
+
+	// repeated values give the first position, and the next one once it is changed
+	a[500] = 7;
+	a[20] = 7;
+	SCRIPTARRAYSTL_CHECK(Find(a, 7) == 10);
+	a[10] = 30;
+	SCRIPTARRAYSTL_CHECK(Find(a, 7) == 20 && Find(a, 30) == 10);
+
+	// elements added and removed at the end
+	a.push_back(-1);
+	SCRIPTARRAYSTL_CHECK(Find(a, -1) == 1000);
+	a.resize(600);
+	SCRIPTARRAYSTL_CHECK(Find(a, -1) == -1 && Find(a, 1797) == 599 && Find(a, 1800) == -1);
+
+	// inserting in the middle through the array's own methods moves the positions after it
+	int value = 5;
+	a.GetRef()->InsertAt(0, &value);
+	SCRIPTARRAYSTL_CHECK(Find(a, 5) == 0 && Find(a, 30) == 11 && Find(a, 7) == 21);
+
+	a.Release();
+}
+
+static void TestUpdate(asIScriptEngine *engine)
+{
+	CScriptArraySTL<int, CScriptArrayIndexed> a;
+	a.InitArray(engine, 100);
+	for(int i = 0; i < 100; ++i) a[i] = i;
+	SCRIPTARRAYSTL_CHECK(Find(a, 50) == 50);
+
+	// a write the array doesn't see, like one made by a script, needs Update()
+	int *data = (int *)a.GetRef()->GetBuffer();
+	data[50] = 1000;
+	SCRIPTARRAYSTL_CHECK(Find(a, 1000) == -1);
+	a.GetRef()->Update();
+	SCRIPTARRAYSTL_CHECK(Find(a, 1000) == 50 && Find(a, 50) == -1);
+
+	// with write detection Update() only re-hashes the blocks that changed
+	a.GetRef()->EnableWriteDetection(8);
+	data[70] = 2000;
+	data[71] = 2000;
+	a.GetRef()->Update();
+	SCRIPTARRAYSTL_CHECK(Find(a, 2000) == 70 && Find(a, 70) == -1 && Find(a, 72) == 72);
+
+	// Rebuild() gives the same answers
+	a.GetRef()->Rebuild();
+	SCRIPTARRAYSTL_CHECK(Find(a, 2000) == 70 && Find(a, 1000) == 50 && Find(a, 99) == 99);
+
+	a.Release();
+}
+
+static void TestKinds(asIScriptEngine *engine)
+{
+	CScriptArraySTL<std::string, CScriptArrayIndexed> names;
+	names.InitArray(engine);
+	names.push_back("alpha");
+	names.push_back("beta");
+	names.push_back("alpha");
+	std::string key("alpha");
+	SCRIPTARRAYSTL_CHECK(names.GetRef()->IndexOf(&key) == 0);
+	key = "beta";
+	SCRIPTARRAYSTL_CHECK(names.GetRef()->IndexOf(&key) == 1);
+	key = "gamma";
+	SCRIPTARRAYSTL_CHECK(!names.GetRef()->Contains(&key));
+	names.Release();
+
+	// floats are compared by value like Find() does
+	CScriptArraySTL<float, CScriptArrayIndexed> f;
+	f.InitArray(engine);
+	f.push_back(1.5f);
+	f.push_back(-0.0f);
+	f.push_back(std::numeric_limits<float>::quiet_NaN());
+	float zero = 0.0f;
+	float nan = std::numeric_limits<float>::quiet_NaN();
+	SCRIPTARRAYSTL_CHECK(f.GetRef()->IndexOf(&zero) == 1 && f.GetRef()->IndexOf(&nan) == -1);
+	f.Release();
+}
+
+int main()
+{
+	CScriptArraySTLMemory::Install();
+	asIScriptEngine *engine = ScriptArraySTLTestCreateEngine();
+
+	TestApply(engine);
+	TestUpdate(engine);
+	TestKinds(engine);
+
+	engine->Release();
+	return ScriptArraySTLTestResult("ScriptArraySTLIndexedTest");
+}
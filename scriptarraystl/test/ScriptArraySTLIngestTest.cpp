@@ -0,0 +1,93 @@
+// Tests that CScriptArraySTLIngest claims batches all or nothing, keeps elements in order when the
+// queue wraps around and delivers every element pushed by several producer threads.
+#include <thread>
+#include <vector>
+
+#include "ScriptArraySTLTestUtil.h"
+#include "../ScriptArraySTLIngest.h"
+
+static void TestBatches(asIScriptEngine *engine)
+{
+	CScriptArraySTL<int> out;
+	out.InitArray(engine);
+
+	CScriptArraySTLIngest<int> queue(8, 4);
+	SCRIPTARRAYSTL_CHECK(queue.capacity() == 8);
+
+	int values[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12 };
+	SCRIPTARRAYSTL_CHECK(queue.try_push(values, 6));
+	SCRIPTARRAYSTL_CHECK(queue.drain(out) == 4 && out.size() == 4 && out[3] == 3);
+
+	// six slots are free, so a batch of seven is refused and nothing is pushed
+	SCRIPTARRAYSTL_CHECK(!queue.try_push(values + 6, 7));
+	SCRIPTARRAYSTL_CHECK(queue.size() == 2);
+
+	// a batch of five wraps around the end of the slots
+	SCRIPTARRAYSTL_CHECK(queue.try_push(values + 6, 5));
+	SCRIPTARRAYSTL_CHECK(queue.try_push(values[11]));
+	SCRIPTARRAYSTL_CHECK(!queue.try_push(values[12]));
+	SCRIPTARRAYSTL_CHECK(queue.size() == 8);
+
+	SCRIPTARRAYSTL_CHECK(queue.drain(out, 100) == 8);
+	bool in_order = out.size() == 12;
+	for(size_t i = 0; in_order && i < out.size(); ++i) in_order = out[i] == (int)i;
+	SCRIPTARRAYSTL_CHECK(in_order);
+	SCRIPTARRAYSTL_CHECK(queue.drain(out) == 0);
+
+	SScriptArraySTLIngestStats stats = queue.GetStats();
+	SCRIPTARRAYSTL_CHECK(stats.pushed == 12 && stats.drained == 12 && stats.rejected == 2);
+	SCRIPTARRAYSTL_CHECK(stats.drains == 2 && stats.high_water == 8);
+
+	out.Release();
+}
+
+template <bool multi_producer>
+static void TestProducers(asIScriptEngine *engine, int producers)
+{
+	const int per_producer = 20000;
+
+	CScriptArraySTL<int> out;
+	out.InitArray(engine);
+
+	// a small queue so the producers wait for drain() and wrap around many times
+	CScriptArraySTLIngest<int, multi_producer> queue(64, 16);
+	std::vector<std::thread> threads;
+	for(int p = 0; p < producers; ++p)
+	{
+		threads.push_back(std::thread([&queue, p]()
+		{
+			for(int i = 0; i < per_producer; ++i) queue.push(p * per_producer + i);
+		}));
+	}
+
+	size_t total = (size_t)producers * per_producer;
+	while(out.size() < total) queue.drain(out);
+	for(size_t i = 0; i < threads.size(); ++i) threads[i].join();
+
+	// every element arrives once, and each producer's elements stay in order
+	std::vector<int> next(producers, 0);
+	std::vector<bool> seen(total, false);
+	bool ok = out.size() == total;
+	for(size_t i = 0; ok && i < out.size(); ++i)
+	{
+		int p = out[i] / per_producer;
+		ok = !seen[out[i]] && out[i] % per_producer == next[p];
+		seen[out[i]] = true;
+		next[p]++;
+	}
+	SCRIPTARRAYSTL_CHECK(ok);
+
+	out.Release();
+}
+
+int main()
+{
+	asIScriptEngine *engine = ScriptArraySTLTestCreateEngine();
+
+	TestBatches(engine);
+	TestProducers<true>(engine, 4);
+	TestProducers<false>(engine, 1);
+
+	engine->Release();
+	return ScriptArraySTLTestResult("ScriptArraySTLIngestTest");
+}
@@ -0,0 +1,52 @@
+// Tests that CScriptArraySTLLazy only generates the blocks that are read, keeps them until
+// invalidate() and copies every element with copy_to().
+#include <string>
+
+#include "ScriptArraySTLTestUtil.h"
+#include "../ScriptArraySTLLazy.h"
+
+int main()
+{
+	asIScriptEngine *engine = ScriptArraySTLTestCreateEngine();
+
+	int calls = 0;
+	CScriptArraySTLLazy<int> squares(1000, [&calls](asUINT first, asUINT count, int *out)
+	{
+		++calls;
+		for(asUINT i = 0; i < count; ++i) out[i] = (int)((first + i) * (first + i));
+	}, 64);
+	SCRIPTARRAYSTL_CHECK(squares.size() == 1000 && calls == 0 && !squares.generated(0));
+
+	// reading an element generates its block once
+	SCRIPTARRAYSTL_CHECK(squares[70] == 4900 && squares[127] == 127 * 127 && calls == 1);
+	SCRIPTARRAYSTL_CHECK(squares.generated(64) && !squares.generated(63) && !squares.generated(128));
+
+	// the last block is shorter
+	SCRIPTARRAYSTL_CHECK(squares[999] == 999 * 999 && calls == 2);
+	const SScriptArraySTLLazyStats &stats = squares.GetStats();
+	SCRIPTARRAYSTL_CHECK(stats.blocks_generated == 2 && stats.elements_generated == 64 + 1000 - 960);
+	SCRIPTARRAYSTL_CHECK(stats.resident_bytes == stats.elements_generated * sizeof(int));
+
+	// invalidated blocks are generated again
+	squares.invalidate();
+	SCRIPTARRAYSTL_CHECK(!squares.generated(70) && stats.resident_bytes == 0);
+	SCRIPTARRAYSTL_CHECK(squares[70] == 4900 && calls == 3);
+
+	// copy_to() generates the rest
+	CScriptArraySTL<int> a;
+	a.InitArray(engine);
+	squares.copy_to(a);
+	SCRIPTARRAYSTL_CHECK(a.size() == 1000 && a[0] == 0 && a[500] == 250000 && a[999] == 999 * 999);
+	SCRIPTARRAYSTL_CHECK(calls == 3 + 15 && stats.blocks_generated == 18);
+	a.Release();
+
+	// elements of object types
+	CScriptArraySTLLazy<std::string> names(10, [](asUINT first, asUINT count, std::string *out)
+	{
+		for(asUINT i = 0; i < count; ++i) out[i] = std::string(first + i, 'x');
+	});
+	SCRIPTARRAYSTL_CHECK(names[3] == "xxx" && names[9].size() == 9);
+
+	engine->Release();
+	return ScriptArraySTLTestResult("ScriptArraySTLLazyTest");
+}
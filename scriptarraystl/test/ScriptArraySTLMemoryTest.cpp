@@ -0,0 +1,179 @@
+// Tests that script arrays, including the array classes derived from CScriptArray, are allocated
+// and freed through CScriptArraySTLMemory once it is installed, so Release() returns every object
+// and buffer to the source it came from.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+#include "ScriptArraySTLTestUtil.h"
+#include "../ScriptArraySTLArena.h"
+#include "../ScriptArraySTLMapped.h"
+#include "../ScriptArraySTLPool.h"
+#include "../ScriptArraySTLSmall.h"
+#include "../ScriptArraySTLView.h"
+
+// a source that counts the blocks it hands out
+class CCountingSource : public CScriptArraySTLBufferSource
+{
+public:
+	int live;
+	int allocations;
+
+	CCountingSource() : live(0), allocations(0) {}
+
+	virtual void *AllocateBlock(size_t size)
+	{
+		++live;
+		++allocations;
+		return malloc(size);
+	}
+
+	virtual void FreeBlock(void *block, size_t)
+	{
+		--live;
+		free(block);
+	}
+};
+
+// creates an array with everything allocated from a counting source, fills it and releases it
+template <class TArrayClass>
+static void TestRelease(asIScriptEngine *engine)
+{
+	CCountingSource source;
+	{
+		CScriptArraySTLSourceScope scope(&source);
+
+		CScriptArraySTL<int, TArrayClass> a;
+		SCRIPTARRAYSTL_CHECK(a.InitArray(engine, 4) == 0);
+		for(int i = 0; i < 100; ++i) a.push_back(i);
+		SCRIPTARRAYSTL_CHECK(a.size() == 104 && a[103] == 99);
+
+		// the array object has a block header like its buffer
+		SCRIPTARRAYSTL_CHECK(CScriptArraySTLMemory::GetBlock(a.GetRef())->source == &source);
+
+		a.Release();
+	}
+	SCRIPTARRAYSTL_CHECK(source.allocations > 0 && source.live == 0);
+}
+
+static void TestSmall(asIScriptEngine *engine)
+{
+	// The first array<string> makes the array add-on cache information about the string type
+	// until the engine is destroyed. That has to come from the heap, not the counted source.
+	CScriptArraySTL<std::string> first;
+	first.InitArray(engine);
+	first.Release();
+
+	CCountingSource source;
+	{
+		CScriptArraySTLSourceScope scope(&source);
+
+		CScriptArraySTL<float, CScriptArraySmall<8> > a;
+		a.InitArray(engine, 3);
+		SCRIPTARRAYSTL_CHECK(a.GetRef()->IsInline() && a.size() == 3);
+
+		// only the array object is still allocated
+		SCRIPTARRAYSTL_CHECK(source.live == 1);
+		for(int i = 0; i < 5; ++i) a.push_back((float)i);
+		SCRIPTARRAYSTL_CHECK(a.GetRef()->IsInline() && source.live == 1 && a[7] == 4.0f);
+
+		// the ninth element moves it to the heap
+		a.push_back(8.0f);
+		SCRIPTARRAYSTL_CHECK(!a.GetRef()->IsInline() && source.live == 2 && a[8] == 8.0f && a[3] == 0.0f);
+		a.Release();
+
+		// arrays that start out bigger than the inline buffer never use it
+		CScriptArraySTL<std::string, CScriptArraySmall<2> > s;
+		s.InitArray(engine, 3);
+		SCRIPTARRAYSTL_CHECK(!s.GetRef()->IsInline() && s.size() == 3);
+		s.Release();
+
+		CScriptArraySTL<std::string, CScriptArraySmall<4> > t;
+		t.InitArray(engine, 2);
+		t[1] = "inline";
+		t.push_back("string");
+		SCRIPTARRAYSTL_CHECK(t.GetRef()->IsInline() && t[1] == "inline" && t[2] == "string");
+		t.Release();
+	}
+	SCRIPTARRAYSTL_CHECK(source.live == 0);
+}
+
+static void TestPooled(asIScriptEngine *engine)
+{
+	CCountingSource source;
+	{
+		CScriptArraySTLSourceScope scope(&source);
+
+		CScriptArraySTL<int, CScriptArrayPooled> a;
+		a.InitArray(engine, 4);
+		CScriptArrayPooled *as_array = a.GetRef();
+		SCRIPTARRAYSTL_CHECK(CScriptArraySTLMemory::GetBlock(as_array)->source == &source);
+
+		// the released array waits in the pool and is used again
+		a.Release();
+		SCRIPTARRAYSTL_CHECK(source.live == 2);
+		a.InitArray(engine, 4);
+		SCRIPTARRAYSTL_CHECK(a.GetRef() == as_array);
+		a.Release();
+
+		// trimming the pool releases it
+		CScriptArraySTLPool::Get(engine).Trim();
+	}
+	SCRIPTARRAYSTL_CHECK(source.live == 0);
+}
+
+static void TestMapped(asIScriptEngine *engine)
+{
+	const char *path = "ScriptArraySTLMemoryTest.bin";
+	CScriptArraySTL<float> saved;
+	saved.InitArray(engine, 3);
+	saved[0] = 1.0f;
+	saved[2] = 3.0f;
+	SCRIPTARRAYSTL_CHECK(CScriptArrayMapped::Save(path, saved.GetRef()) == 0);
+	saved.Release();
+
+	CCountingSource source;
+	{
+		CScriptArraySTLSourceScope scope(&source);
+
+		int error = 1;
+		CScriptArraySTL<float, CScriptArrayMapped> a(CScriptArrayMapped::Open<float>(engine, path, CScriptArrayMapped::COPY_ON_WRITE, &error), false);
+		SCRIPTARRAYSTL_CHECK(error == 0 && a.GetRef()->IsMapped() && a.size() == 3 && a[2] == 3.0f);
+		SCRIPTARRAYSTL_CHECK(CScriptArraySTLMemory::GetBlock(a.GetRef())->source == &source);
+
+		// growing moves the elements to a buffer from the source
+		a.push_back(4.0f);
+		SCRIPTARRAYSTL_CHECK(!a.GetRef()->IsMapped() && source.live == 2 && a[0] == 1.0f && a[3] == 4.0f);
+		a.Release();
+
+		// released while the elements are still mapped
+		CScriptArraySTL<float, CScriptArrayMapped> b(CScriptArrayMapped::Open<float>(engine, path, CScriptArrayMapped::READ_ONLY), false);
+		SCRIPTARRAYSTL_CHECK(b.GetRef()->IsMapped() && b[0] == 1.0f && source.live == 1);
+		b.Release();
+	}
+	SCRIPTARRAYSTL_CHECK(source.live == 0);
+	remove(path);
+}
+
+int main()
+{
+	CScriptArraySTLMemory::Install();
+	asIScriptEngine *engine = ScriptArraySTLTestCreateEngine();
+
+	TestRelease<CScriptArray>(engine);
+	TestRelease<CScriptArrayArena>(engine);
+	TestRelease<CScriptArrayView>(engine);
+	TestRelease<CScriptArraySmall<8> >(engine);
+	TestPooled(engine);
+	TestSmall(engine);
+	TestMapped(engine);
+
+	// arrays made without a source still come from asAllocMem()
+	CScriptArraySTL<int> a;
+	a.InitArray(engine, 3);
+	SCRIPTARRAYSTL_CHECK(CScriptArraySTLMemory::GetBlock(a.GetRef())->source == NULL);
+	a.Release();
+
+	engine->Release();
+	return ScriptArraySTLTestResult("ScriptArraySTLMemoryTest");
+}
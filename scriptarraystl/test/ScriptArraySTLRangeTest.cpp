@@ -0,0 +1,152 @@
+// Tests assign, insert and append with iterator ranges, including ranges taken from the array
+// itself and the references held by arrays of handles.
+#include <list>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ScriptArraySTLTestUtil.h"
+#include "../ScriptArraySTL.h"
+
+// a reference counted type for testing arrays of handles
+struct Obj
+{
+	int refs;
+	Obj() : refs(1) {}
+};
+
+static void ObjAddRef(Obj *obj)
+{
+	++obj->refs;
+}
+
+static void ObjRelease(Obj *obj)
+{
+	--obj->refs;
+}
+
+template <class Array, class T>
+static bool Equals(const Array &a, const std::vector<T> &expected)
+{
+	if(a.size() != expected.size()) return false;
+	for(size_t i = 0; i < expected.size(); ++i)
+	{
+		if(!(a[i] == expected[i])) return false;
+	}
+	return true;
+}
+
+static void TestInts(asIScriptEngine *engine)
+{
+	char decl[] = "array<int>";
+	CScriptArraySTL<int> a;
+	a.InitArray(engine, decl);
+
+	std::vector<int> values;
+	for(int i = 0; i < 6; ++i) values.push_back(i);
+
+	a.assign(values.begin(), values.end());
+	SCRIPTARRAYSTL_CHECK(Equals(a, values));
+
+	// ranges inside the array
+	a.append(a.begin(), a.end());
+	int appended[] = { 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5 };
+	SCRIPTARRAYSTL_CHECK(Equals(a, std::vector<int>(appended, appended + 12)));
+
+	a.assign(values.begin(), values.end());
+	a.insert(a.begin(), a.begin() + 2, a.begin() + 4);
+	int inserted[] = { 2, 3, 0, 1, 2, 3, 4, 5 };
+	SCRIPTARRAYSTL_CHECK(Equals(a, std::vector<int>(inserted, inserted + 8)));
+
+	a.assign(a.begin() + 3, a.begin() + 6);
+	int assigned[] = { 1, 2, 3 };
+	SCRIPTARRAYSTL_CHECK(Equals(a, std::vector<int>(assigned, assigned + 3)));
+
+	// a forward range that isn't a pointer and a single pass range
+	std::list<int> l(values.begin(), values.end());
+	a.assign(l.begin(), l.end());
+	SCRIPTARRAYSTL_CHECK(Equals(a, values));
+
+	std::istringstream in("7 8 9");
+	a.insert(a.begin() + 1, std::istream_iterator<int>(in), std::istream_iterator<int>());
+	int streamed[] = { 0, 7, 8, 9, 1, 2, 3, 4, 5 };
+	SCRIPTARRAYSTL_CHECK(Equals(a, std::vector<int>(streamed, streamed + 9)));
+
+	a.Release();
+}
+
+static void TestStrings(asIScriptEngine *engine)
+{
+	char decl[] = "array<string>";
+	CScriptArraySTL<std::string> a;
+	a.InitArray(engine, decl);
+
+	const char *names[] = { "a", "b", "c", "d" };
+	std::vector<std::string> values(names, names + 4);
+
+	a.assign(values.begin(), values.end());
+	a.append(a.begin(), a.end());
+	const char *appended[] = { "a", "b", "c", "d", "a", "b", "c", "d" };
+	SCRIPTARRAYSTL_CHECK(Equals(a, std::vector<std::string>(appended, appended + 8)));
+
+	a.assign(values.begin(), values.end());
+	a.insert(a.begin() + 1, a.begin() + 2, a.begin() + 4);
+	const char *inserted[] = { "a", "c", "d", "b", "c", "d" };
+	SCRIPTARRAYSTL_CHECK(Equals(a, std::vector<std::string>(inserted, inserted + 6)));
+
+	a.assign(a.begin() + 2, a.end());
+	const char *assigned[] = { "d", "b", "c", "d" };
+	SCRIPTARRAYSTL_CHECK(Equals(a, std::vector<std::string>(assigned, assigned + 4)));
+
+	a.Release();
+}
+
+static void TestHandles(asIScriptEngine *engine)
+{
+	engine->RegisterObjectType("Obj", 0, asOBJ_REF);
+	engine->RegisterObjectBehaviour("Obj", asBEHAVE_ADDREF, "void f()", asFUNCTION(ObjAddRef), asCALL_CDECL_OBJLAST);
+	engine->RegisterObjectBehaviour("Obj", asBEHAVE_RELEASE, "void f()", asFUNCTION(ObjRelease), asCALL_CDECL_OBJLAST);
+
+	Obj objs[3];
+	std::vector<Obj *> handles;
+	for(int i = 0; i < 3; ++i) handles.push_back(&objs[i]);
+
+	char decl[] = "array<Obj@>";
+	CScriptArraySTL<Obj *> a;
+	a.InitArray(engine, decl);
+
+	// every handle copied in holds a reference
+	a.assign(handles.begin(), handles.end());
+	SCRIPTARRAYSTL_CHECK(objs[0].refs == 2 && objs[1].refs == 2 && objs[2].refs == 2);
+
+	a.insert(a.begin(), handles.begin(), handles.begin() + 1);
+	SCRIPTARRAYSTL_CHECK(objs[0].refs == 3);
+
+	a.append(a.begin(), a.end());
+	SCRIPTARRAYSTL_CHECK(a.size() == 8 && objs[0].refs == 5 && objs[1].refs == 3 && objs[2].refs == 3);
+
+	// assigning replaces the old references
+	a.assign(a.begin() + 2, a.begin() + 4);
+	SCRIPTARRAYSTL_CHECK(a.size() == 2 && a[0] == &objs[1] && a[1] == &objs[2]);
+	SCRIPTARRAYSTL_CHECK(objs[0].refs == 1 && objs[1].refs == 2 && objs[2].refs == 2);
+
+	// filling with one of the array's own handles
+	a.assign(3, a[1]);
+	SCRIPTARRAYSTL_CHECK(a.size() == 3 && a[0] == &objs[2] && a[2] == &objs[2]);
+	SCRIPTARRAYSTL_CHECK(objs[1].refs == 1 && objs[2].refs == 4);
+
+	a.Release();
+	SCRIPTARRAYSTL_CHECK(objs[0].refs == 1 && objs[1].refs == 1 && objs[2].refs == 1);
+}
+
+int main()
+{
+	asIScriptEngine *engine = ScriptArraySTLTestCreateEngine();
+
+	TestInts(engine);
+	TestStrings(engine);
+	TestHandles(engine);
+
+	engine->Release();
+	return ScriptArraySTLTestResult("ScriptArraySTLRangeTest");
+}
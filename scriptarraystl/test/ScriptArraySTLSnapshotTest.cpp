@@ -0,0 +1,127 @@
+// Tests that CScriptArraySTLSnapshot reuses copies nobody is reading, copies only the changed
+// ranges plus the ones a reused copy missed, and keeps every view unchanged while it is held.
+#include <vector>
+
+#include "ScriptArraySTLTestUtil.h"
+#include "../ScriptArraySTLSnapshot.h"
+
+template <class View>
+static bool Matches(const View &v, const CScriptArraySTL<int> &a)
+{
+	if(v.size() != a.size()) return false;
+	for(size_t i = 0; i < a.size(); ++i)
+	{
+		if(v[i] != a[i]) return false;
+	}
+	return true;
+}
+
+static void TestReuse(asIScriptEngine *engine)
+{
+	CScriptArraySTL<int> a;
+	a.InitArray(engine, 10);
+	for(int i = 0; i < 10; ++i) a[i] = i;
+
+	CScriptArraySTLSnapshot<int> snapshot(3);
+	SCRIPTARRAYSTL_CHECK(snapshot.publish(a) && snapshot.version() == 1);
+	CScriptArraySTLSnapshot<int>::view first = snapshot.acquire();
+
+	// copies that were never used are copied in full even when ranges are given
+	a[2] = 20;
+	SScriptArraySTLRange changed2 = { 2, 3 };
+	SCRIPTARRAYSTL_CHECK(snapshot.publish(a, &changed2, &changed2 + 1));
+	a[5] = 50;
+	SScriptArraySTLRange changed5 = { 5, 6 };
+	SCRIPTARRAYSTL_CHECK(snapshot.publish(a, &changed5, &changed5 + 1));
+	SCRIPTARRAYSTL_CHECK(snapshot.GetStats().full_copies == 3 && snapshot.GetStats().elements_copied == 30);
+
+	// the first view still sees version 1
+	SCRIPTARRAYSTL_CHECK(first.version() == 1 && first[2] == 2 && first[5] == 5);
+	first.reset();
+
+	// The newest copy nobody is reading, version 2, is reused. It gets the new range and the one
+	// it missed.
+	a[7] = 70;
+	SScriptArraySTLRange changed7 = { 7, 8 };
+	SCRIPTARRAYSTL_CHECK(snapshot.publish(a, &changed7, &changed7 + 1));
+	SCRIPTARRAYSTL_CHECK(snapshot.GetStats().full_copies == 3 && snapshot.GetStats().elements_copied == 32);
+
+	CScriptArraySTLSnapshot<int>::view current = snapshot.acquire();
+	SCRIPTARRAYSTL_CHECK(current.version() == 4 && Matches(current, a));
+	current.reset();
+
+	// changing the size copies everything
+	a.push_back(10);
+	SCRIPTARRAYSTL_CHECK(snapshot.publish(a, &changed7, &changed7));
+	SCRIPTARRAYSTL_CHECK(snapshot.GetStats().full_copies == 4);
+	current = snapshot.acquire();
+	SCRIPTARRAYSTL_CHECK(Matches(current, a));
+	current.reset();
+
+	a.Release();
+}
+
+static void TestPending(asIScriptEngine *engine)
+{
+	CScriptArraySTL<int> a;
+	a.InitArray(engine, 100);
+
+	CScriptArraySTLSnapshot<int> snapshot(2);
+	snapshot.publish(a);
+	CScriptArraySTLSnapshot<int>::view v1 = snapshot.acquire();
+	a[1] = 1;
+	SScriptArraySTLRange changed1 = { 1, 2 };
+	snapshot.publish(a, &changed1, &changed1 + 1);
+	CScriptArraySTLSnapshot<int>::view v2 = snapshot.acquire();
+
+	// both copies are being read, so nothing is published but the change is remembered
+	a[3] = 3;
+	SScriptArraySTLRange changed3 = { 3, 4 };
+	SCRIPTARRAYSTL_CHECK(!snapshot.publish(a, &changed3, &changed3 + 1));
+	SCRIPTARRAYSTL_CHECK(snapshot.GetStats().skipped == 1 && v2.version() == 2 && v2[3] == 0);
+	v1.reset();
+	v2.reset();
+
+	a[4] = 4;
+	SScriptArraySTLRange changed4 = { 4, 5 };
+	SCRIPTARRAYSTL_CHECK(snapshot.publish(a, &changed4, &changed4 + 1));
+	CScriptArraySTLSnapshot<int>::view v3 = snapshot.acquire();
+	SCRIPTARRAYSTL_CHECK(v3.version() == 3 && Matches(v3, a));
+	v3.reset();
+
+	// more ranges than a copy can hold make it copy everything
+	std::vector<SScriptArraySTLRange> many;
+	for(size_t i = 0; i < SCRIPTARRAYSTL_SNAPSHOT_MAX_RANGES + 1; ++i)
+	{
+		a[i] = (int)i + 1000;
+		SScriptArraySTLRange range = { i, i + 1 };
+		many.push_back(range);
+	}
+	size_t full_copies = snapshot.GetStats().full_copies;
+	SCRIPTARRAYSTL_CHECK(snapshot.publish(a, many.begin(), many.end()));
+	SCRIPTARRAYSTL_CHECK(snapshot.GetStats().full_copies == full_copies + 1);
+	v3 = snapshot.acquire();
+	SCRIPTARRAYSTL_CHECK(Matches(v3, a));
+	v3.reset();
+
+	// and the other copy, which missed them, catches up
+	a[99] = 99;
+	SScriptArraySTLRange changed99 = { 99, 100 };
+	SCRIPTARRAYSTL_CHECK(snapshot.publish(a, &changed99, &changed99 + 1));
+	v3 = snapshot.acquire();
+	SCRIPTARRAYSTL_CHECK(Matches(v3, a));
+	v3.reset();
+
+	a.Release();
+}
+
+int main()
+{
+	asIScriptEngine *engine = ScriptArraySTLTestCreateEngine();
+
+	TestReuse(engine);
+	TestPending(engine);
+
+	engine->Release();
+	return ScriptArraySTLTestResult("ScriptArraySTLSnapshotTest");
+}
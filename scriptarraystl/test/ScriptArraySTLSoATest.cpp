@@ -0,0 +1,61 @@
+// Tests that CScriptArraySTLSoA's iterators work with the standard algorithms, including sorting
+// through the proxy references.
+#include <algorithm>
+
+#include "ScriptArraySTLTestUtil.h"
+#include "../ScriptArraySTLSoA.h"
+
+struct Particle
+{
+	float x;
+	int   id;
+
+	Particle() : x(0), id(0) {}
+	Particle(float x_, int id_) : x(x_), id(id_) {}
+};
+
+typedef CScriptArraySTLSoA<Particle,
+	SCRIPTARRAYSTL_SOA_FIELD(Particle, x),
+	SCRIPTARRAYSTL_SOA_FIELD(Particle, id)> ParticleSoA;
+
+static bool ByX(const Particle &a, const Particle &b)
+{
+	return a.x < b.x;
+}
+
+int main()
+{
+	ParticleSoA soa;
+	for(int i = 0; i < 100; ++i) soa.push_back(Particle((float)((i * 37) % 100), i));
+
+	// the iterators are random access in both directions
+	ParticleSoA::iterator first = soa.begin();
+	ParticleSoA::iterator last = soa.end();
+	SCRIPTARRAYSTL_CHECK(last - first == 100 && 2 + first == first + 2 && first + 2 > first);
+	SCRIPTARRAYSTL_CHECK(first <= first && last >= first && !(first > last));
+
+	// swapping references swaps the elements
+	swap(soa[0], soa[1]);
+	SCRIPTARRAYSTL_CHECK(soa.get(0).id == 1 && soa.get(1).id == 0);
+	swap(soa[0], soa[1]);
+
+	std::sort(soa.begin(), soa.end(), ByX);
+	bool sorted = true;
+	for(size_t i = 0; i < soa.size(); ++i)
+	{
+		// each x stays with its id
+		Particle p = soa[i];
+		sorted = sorted && p.x == (float)i && (p.id * 37) % 100 == (int)i;
+	}
+	SCRIPTARRAYSTL_CHECK(sorted);
+
+	// const iterators give copies of the elements
+	const ParticleSoA &c = soa;
+	int ids = 0;
+	for(ParticleSoA::const_iterator it = c.begin(); it != c.end(); ++it) ids += (*it).id;
+	SCRIPTARRAYSTL_CHECK(ids == 99 * 100 / 2);
+	ParticleSoA::const_iterator converted = soa.begin();
+	SCRIPTARRAYSTL_CHECK(converted == c.begin() && std::find_if(c.begin(), c.end(), [](const Particle &p) { return p.id == 37; }) - c.begin() == 69);
+
+	return ScriptArraySTLTestResult("ScriptArraySTLSoATest");
+}
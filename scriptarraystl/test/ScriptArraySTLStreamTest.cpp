@@ -0,0 +1,130 @@
+// Tests that save_array() and load_array() round trip arrays, convert snapshots written with the
+// other byte order and reject damaged snapshots without allocating for elements that aren't there.
+#include <sstream>
+#include <string>
+
+#include "ScriptArraySTLTestUtil.h"
+#include "../ScriptArraySTLStream.h"
+
+// Rewrites a snapshot of numbers or strings as a machine with the other byte order would have
+// written it
+static std::string SwapSnapshot(const std::string &snapshot, size_t element_size, bool strings)
+{
+	std::string swapped = snapshot;
+	SScriptArraySTLStreamHeader header;
+	memcpy(&header, &swapped[0], sizeof(header));
+	size_t offset = sizeof(header) + header.decl_length;
+
+	ScriptArraySTL_SwapBytes(&header.byte_order, sizeof(header.byte_order), 1);
+	ScriptArraySTL_SwapBytes(&header.version, sizeof(header.version), 1);
+	ScriptArraySTL_SwapBytes(&header.decl_length, sizeof(header.decl_length), 1);
+	ScriptArraySTL_SwapBytes(&header.element_size, sizeof(header.element_size), 1);
+	ScriptArraySTL_SwapBytes(&header.count, sizeof(header.count), 1);
+	memcpy(&swapped[0], &header, sizeof(header));
+
+	if(!strings)
+	{
+		ScriptArraySTL_SwapBytes(&swapped[offset], element_size, (swapped.size() - offset) / element_size);
+		return swapped;
+	}
+
+	// only the lengths in front of the characters change
+	while(offset < swapped.size())
+	{
+		asDWORD length;
+		memcpy(&length, &swapped[offset], sizeof(length));
+		ScriptArraySTL_SwapBytes(&swapped[offset], sizeof(length), 1);
+		offset += sizeof(length) + length;
+	}
+	return swapped;
+}
+
+static void TestNumbers(asIScriptEngine *engine)
+{
+	CScriptArraySTL<int> a;
+	a.InitArray(engine);
+
+	// more than one chunk
+	const size_t count = SCRIPTARRAYSTL_STREAM_CHUNK_BYTES / sizeof(int) * 2 + 5;
+	for(size_t i = 0; i < count; ++i) a.push_back((int)(i * 7919));
+
+	std::ostringstream out;
+	SCRIPTARRAYSTL_CHECK(save_array(out, a) == 0);
+	std::string snapshot = out.str();
+
+	CScriptArraySTL<int> b;
+	b.InitArray(engine, 3);
+	std::istringstream in(snapshot);
+	SCRIPTARRAYSTL_CHECK(load_array(in, b) == 0);
+	SCRIPTARRAYSTL_CHECK(b.size() == count && b[0] == 0 && b[count - 1] == (int)((count - 1) * 7919));
+
+	// the same snapshot written with the other byte order
+	std::istringstream swapped(SwapSnapshot(snapshot, sizeof(int), false));
+	b.clear();
+	SCRIPTARRAYSTL_CHECK(load_array(swapped, b) == 0);
+	bool same = b.size() == count;
+	for(size_t i = 0; same && i < count; ++i) same = b[i] == a[i];
+	SCRIPTARRAYSTL_CHECK(same);
+
+	// a snapshot of another type
+	CScriptArraySTL<float> f;
+	f.InitArray(engine);
+	std::istringstream other(snapshot);
+	SCRIPTARRAYSTL_CHECK(load_array(other, f) == -3);
+	f.Release();
+
+	// not a snapshot
+	std::istringstream garbage(std::string(64, 'x'));
+	SCRIPTARRAYSTL_CHECK(load_array(garbage, b) == -2);
+
+	// A count far bigger than the data only grows the array as far as the stream goes. The elements
+	// that did arrive are kept.
+	std::string damaged = snapshot.substr(0, snapshot.size() - sizeof(int) * 3);
+	SScriptArraySTLStreamHeader header;
+	memcpy(&header, &damaged[0], sizeof(header));
+	header.count = 0xFFFFFFF0u;
+	memcpy(&damaged[0], &header, sizeof(header));
+	std::istringstream truncated(damaged);
+	SCRIPTARRAYSTL_CHECK(load_array(truncated, b) == -1);
+	SCRIPTARRAYSTL_CHECK(b.size() == count - 3 && b[count - 4] == a[count - 4]);
+
+	a.Release();
+	b.Release();
+}
+
+static void TestStrings(asIScriptEngine *engine)
+{
+	CScriptArraySTL<std::string> a;
+	a.InitArray(engine);
+	a.push_back("");
+	a.push_back("short");
+	a.push_back(std::string(SCRIPTARRAYSTL_STREAM_CHUNK_BYTES + 10, 'l'));
+	a.push_back("after the long one");
+
+	std::ostringstream out;
+	SCRIPTARRAYSTL_CHECK(save_array(out, a) == 0);
+
+	CScriptArraySTL<std::string> b;
+	b.InitArray(engine, 1);
+	std::istringstream in(out.str());
+	SCRIPTARRAYSTL_CHECK(load_array(in, b) == 0);
+	SCRIPTARRAYSTL_CHECK(b.size() == 4 && b[0].empty() && b[1] == "short" && b[2] == a[2] && b[3] == a[3]);
+
+	std::istringstream swapped(SwapSnapshot(out.str(), 0, true));
+	SCRIPTARRAYSTL_CHECK(load_array(swapped, b) == 0);
+	SCRIPTARRAYSTL_CHECK(b.size() == 4 && b[1] == "short" && b[2] == a[2] && b[3] == a[3]);
+
+	a.Release();
+	b.Release();
+}
+
+int main()
+{
+	asIScriptEngine *engine = ScriptArraySTLTestCreateEngine();
+
+	TestNumbers(engine);
+	TestStrings(engine);
+
+	engine->Release();
+	return ScriptArraySTLTestResult("ScriptArraySTLStreamTest");
+}
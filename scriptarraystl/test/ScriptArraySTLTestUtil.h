@@ -0,0 +1,43 @@
+// Helpers shared by the CScriptArraySTL tests. Each test is a small program that sets up an engine
+// with the string and array add-ons, runs its checks and returns non-zero if any of them failed.
+#pragma once
+
+#include <stdio.h>
+
+#include <angelscript.h>
+#include "scriptstdstring/scriptstdstring.h"
+#include "scriptarray/scriptarray.h"
+
+// records a failure without stopping the test, so one run reports every broken check
+#define SCRIPTARRAYSTL_CHECK(condition) \
+	do { if(!(condition)) { printf("%s(%d): check failed: %s\n", __FILE__, __LINE__, #condition); ++ScriptArraySTLTestFailures(); } } while(0)
+
+inline int &ScriptArraySTLTestFailures()
+{
+	static int failures = 0;
+	return failures;
+}
+
+inline void ScriptArraySTLTestMessageCallback(const asSMessageInfo *msg, void *)
+{
+	printf("%s (%d, %d) : %s\n", msg->section, msg->row, msg->col, msg->message);
+}
+
+// creates an engine with string and array<T> registered
+inline asIScriptEngine *ScriptArraySTLTestCreateEngine()
+{
+	asIScriptEngine *engine = asCreateScriptEngine(ANGELSCRIPT_VERSION);
+	engine->SetMessageCallback(asFUNCTION(ScriptArraySTLTestMessageCallback), 0, asCALL_CDECL);
+	RegisterStdString(engine);
+	RegisterScriptArray(engine, true);
+	return engine;
+}
+
+// prints the result and returns the exit code for main()
+inline int ScriptArraySTLTestResult(const char *name)
+{
+	int failures = ScriptArraySTLTestFailures();
+	if(failures == 0) printf("%s: passed\n", name);
+	else printf("%s: %d check(s) failed\n", name, failures);
+	return failures == 0 ? 0 : 1;
+}
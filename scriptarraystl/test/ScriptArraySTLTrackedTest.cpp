@@ -0,0 +1,101 @@
+// Tests that CScriptArrayTracked merges the ranges it records, limits them to the current size and
+// finds writes it didn't see through the block checksums.
+#include <vector>
+
+#include "ScriptArraySTLTestUtil.h"
+#include "../ScriptArraySTLTracked.h"
+
+// true if ranges holds exactly the pairs in expected, which has count pairs of first and last
+static bool RangesAre(const std::vector<SScriptArraySTLRange> &ranges, const size_t *expected, size_t count)
+{
+	if(ranges.size() != count) return false;
+	for(size_t i = 0; i < count; ++i)
+	{
+		if(ranges[i].first != expected[i * 2] || ranges[i].last != expected[i * 2 + 1]) return false;
+	}
+	return true;
+}
+
+static void TestMerging(asIScriptEngine *engine)
+{
+	CScriptArraySTL<int, CScriptArrayTracked> a;
+	a.InitArray(engine, 100);
+	CScriptArrayTracked *as_array = a.GetRef();
+	as_array->ConsumeDirtyRanges();
+	SCRIPTARRAYSTL_CHECK(!as_array->HasDirtyRanges());
+
+	// out of order, overlapping and touching ranges come back sorted and merged
+	a.mark_dirty(50, 60);
+	a.mark_dirty(10, 20);
+	a.mark_dirty(55, 70);
+	a.mark_dirty(20, 25);
+	a.mark_dirty(90, 95);
+	a.mark_dirty(30, 30);
+	size_t merged[] = { 10, 25, 50, 70, 90, 95 };
+	SCRIPTARRAYSTL_CHECK(RangesAre(a.consume_dirty_ranges(), merged, 3));
+	SCRIPTARRAYSTL_CHECK(a.consume_dirty_ranges().empty());
+
+	// writes through the wrapper and the array's own methods
+	a[3] = 1;
+	a[4] = 1;
+	as_array->RemoveAt(98);
+	a.push_back(7);
+	size_t written[] = { 3, 5, 98, 100 };
+	SCRIPTARRAYSTL_CHECK(RangesAre(a.consume_dirty_ranges(), written, 2));
+
+	// ranges past a shrunken end are dropped or cut
+	a.mark_dirty(40, 60);
+	a.mark_dirty(80, 90);
+	a.resize(50);
+	size_t cut[] = { 40, 50 };
+	SCRIPTARRAYSTL_CHECK(RangesAre(a.consume_dirty_ranges(), cut, 1));
+
+	// too many ranges that can't be merged are replaced by one covering all of them
+	a.resize(SCRIPTARRAYSTL_TRACKED_MAX_RANGES * 4);
+	a.consume_dirty_ranges();
+	for(size_t i = 0; i <= SCRIPTARRAYSTL_TRACKED_MAX_RANGES; ++i) as_array->MarkDirty(i * 2, i * 2 + 1);
+	std::vector<SScriptArraySTLRange> compacted = a.consume_dirty_ranges();
+	SCRIPTARRAYSTL_CHECK(compacted.size() == 1 && compacted[0].first == 0 && compacted[0].last == SCRIPTARRAYSTL_TRACKED_MAX_RANGES * 2 + 1);
+
+	a.Release();
+}
+
+static void TestWriteDetection(asIScriptEngine *engine)
+{
+	CScriptArraySTL<int, CScriptArrayTracked> a;
+	a.InitArray(engine, 100);
+	CScriptArrayTracked *as_array = a.GetRef();
+	as_array->EnableWriteDetection(16);
+	as_array->ConsumeDirtyRanges();
+
+	// a write the array doesn't see, like one made by a script
+	int *data = (int *)as_array->GetBuffer();
+	data[40] = 5;
+	a.mark_dirty(2, 3);
+
+	// recorded ranges leave the checksums alone, so the write is found by the next full consume
+	size_t recorded[] = { 2, 3 };
+	SCRIPTARRAYSTL_CHECK(RangesAre(as_array->ConsumeRecordedRanges(), recorded, 1));
+	size_t detected[] = { 32, 48 };
+	SCRIPTARRAYSTL_CHECK(RangesAre(a.consume_dirty_ranges(), detected, 1));
+	SCRIPTARRAYSTL_CHECK(a.consume_dirty_ranges().empty());
+
+	// a partial last block that grows
+	as_array->CScriptArray::Resize(101);
+	size_t grown[] = { 96, 101 };
+	SCRIPTARRAYSTL_CHECK(RangesAre(a.consume_dirty_ranges(), grown, 1));
+
+	a.Release();
+}
+
+int main()
+{
+	CScriptArraySTLMemory::Install();
+	asIScriptEngine *engine = ScriptArraySTLTestCreateEngine();
+
+	TestMerging(engine);
+	TestWriteDetection(engine);
+
+	engine->Release();
+	return ScriptArraySTLTestResult("ScriptArraySTLTrackedTest");
+}